@@ -0,0 +1,136 @@
+#include "AllocTracker.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+const char *const kSubsystemNames[AllocTracker::kSubsystems] = {
+    "other", "generator", "ui", "game loop"};
+
+struct Counters {
+  std::atomic<std::uint64_t> allocations{0};
+  std::atomic<std::uint64_t> bytes{0};
+  std::atomic<std::uint64_t> frames{0};
+  std::atomic<std::uint64_t> frameAllocations{0};
+  std::atomic<std::uint64_t> allocatingFrames{0};
+  std::atomic<std::uint64_t> maxFrameAllocations{0};
+};
+
+// Plain arrays of atomics: constant-initialized, so they are usable from
+// operator new before any constructor has run.
+Counters counters[AllocTracker::kSubsystems];
+thread_local Subsystem currentSubsystem = Subsystem::OTHER;
+thread_local std::uint64_t threadCount = 0;
+
+} // namespace
+
+bool AllocTracker::compiledIn() {
+#ifdef TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+Subsystem AllocTracker::current() { return currentSubsystem; }
+
+void AllocTracker::setCurrent(Subsystem subsystem) {
+  currentSubsystem = subsystem;
+}
+
+std::uint64_t AllocTracker::threadAllocations() { return threadCount; }
+
+void AllocTracker::record(std::size_t bytes) {
+  threadCount++;
+  Counters &c = counters[(int)currentSubsystem];
+  c.allocations.fetch_add(1, std::memory_order_relaxed);
+  c.bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void AllocTracker::frameDone(Subsystem subsystem, std::uint64_t allocations) {
+  Counters &c = counters[(int)subsystem];
+  c.frames.fetch_add(1, std::memory_order_relaxed);
+  if (allocations == 0)
+    return;
+  c.frameAllocations.fetch_add(allocations, std::memory_order_relaxed);
+  c.allocatingFrames.fetch_add(1, std::memory_order_relaxed);
+  std::uint64_t max = c.maxFrameAllocations.load(std::memory_order_relaxed);
+  while (allocations > max &&
+         !c.maxFrameAllocations.compare_exchange_weak(
+             max, allocations, std::memory_order_relaxed))
+    ;
+}
+
+AllocStats AllocTracker::stats(Subsystem subsystem) {
+  const Counters &c = counters[(int)subsystem];
+  return AllocStats{c.allocations.load(std::memory_order_relaxed),
+                    c.bytes.load(std::memory_order_relaxed),
+                    c.frames.load(std::memory_order_relaxed),
+                    c.frameAllocations.load(std::memory_order_relaxed),
+                    c.allocatingFrames.load(std::memory_order_relaxed),
+                    c.maxFrameAllocations.load(std::memory_order_relaxed)};
+}
+
+void AllocTracker::printSummary(std::FILE *out) {
+  std::fprintf(out, "%-10s %12s %14s %10s %12s %10s %10s\n", "subsystem",
+               "allocations", "bytes", "frames", "allocating", "per frame",
+               "max/frame");
+  for (int i = 0; i < kSubsystems; ++i) {
+    AllocStats s = stats((Subsystem)i);
+    std::fprintf(out, "%-10s %12llu %14llu", kSubsystemNames[i],
+                 (unsigned long long)s.allocations,
+                 (unsigned long long)s.bytes);
+    if (s.frames > 0)
+      std::fprintf(out, " %10llu %12llu %10.2f %10llu\n",
+                   (unsigned long long)s.frames,
+                   (unsigned long long)s.allocatingFrames,
+                   (double)s.frameAllocations / s.frames,
+                   (unsigned long long)s.maxFrameAllocations);
+    else
+      std::fprintf(out, " %10s %12s %10s %10s\n", "-", "-", "-", "-");
+  }
+}
+
+#ifdef TRACK_ALLOCATIONS
+
+static void *allocate(std::size_t size) {
+  AllocTracker::record(size);
+  void *p = std::malloc(size != 0 ? size : 1);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+static void *allocateAligned(std::size_t size, std::align_val_t alignment) {
+  AllocTracker::record(size);
+  std::size_t align = (std::size_t)alignment;
+  // aligned_alloc wants a size that is a multiple of the alignment.
+  void *p = std::aligned_alloc(align, (size + align - 1) / align * align);
+  if (p == nullptr)
+    throw std::bad_alloc();
+  return p;
+}
+
+void *operator new(std::size_t size) { return allocate(size); }
+void *operator new[](std::size_t size) { return allocate(size); }
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return allocateAligned(size, alignment);
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return allocateAligned(size, alignment);
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+
+#endif // TRACK_ALLOCATIONS
@@ -0,0 +1,84 @@
+#ifndef ALLOCTRACKER_H
+#define ALLOCTRACKER_H
+
+#include <cstdint>
+#include <cstdio>
+
+// What an allocation is charged to: whatever AllocScope is innermost on the
+// allocating thread.
+enum class Subsystem { OTHER, GENERATOR, UI, GAME_LOOP };
+
+struct AllocStats {
+  std::uint64_t allocations;
+  std::uint64_t bytes;
+  std::uint64_t frames;           // FrameAllocations scopes that finished
+  std::uint64_t frameAllocations; // Allocations made inside those frames
+  std::uint64_t allocatingFrames; // Frames that allocated at all
+  std::uint64_t maxFrameAllocations;
+};
+
+// Heap allocation accounting. Only active in builds with -DTRACK_ALLOCATIONS
+// (`make allocs`), which replace the global operator new; otherwise the scope
+// helpers below compile to nothing and all counts stay zero.
+class AllocTracker {
+public:
+  static const int kSubsystems = 4;
+
+  static bool compiledIn();
+
+  static Subsystem current();
+  static void setCurrent(Subsystem subsystem);
+  static std::uint64_t threadAllocations(); // Made by the calling thread
+  static void record(std::size_t bytes);    // Called by operator new
+  static void frameDone(Subsystem subsystem, std::uint64_t allocations);
+
+  static AllocStats stats(Subsystem subsystem);
+  static void printSummary(std::FILE *out);
+};
+
+// Charges allocations on this thread to `subsystem` while in scope.
+class AllocScope {
+public:
+#ifdef TRACK_ALLOCATIONS
+  explicit AllocScope(Subsystem subsystem) : previous(AllocTracker::current()) {
+    AllocTracker::setCurrent(subsystem);
+  }
+  ~AllocScope() { AllocTracker::setCurrent(previous); }
+#else
+  explicit AllocScope(Subsystem) {}
+#endif
+  AllocScope(const AllocScope &) = delete;
+  AllocScope &operator=(const AllocScope &) = delete;
+
+private:
+#ifdef TRACK_ALLOCATIONS
+  Subsystem previous;
+#endif
+};
+
+// One frame of `subsystem`: counts what this thread allocates while in scope
+// and adds it to the per-frame statistics.
+class FrameAllocations {
+public:
+#ifdef TRACK_ALLOCATIONS
+  explicit FrameAllocations(Subsystem subsystem)
+      : subsystem(subsystem), start(AllocTracker::threadAllocations()) {}
+  ~FrameAllocations() { AllocTracker::frameDone(subsystem, count()); }
+  std::uint64_t count() const {
+    return AllocTracker::threadAllocations() - start;
+  }
+#else
+  explicit FrameAllocations(Subsystem) {}
+  std::uint64_t count() const { return 0; }
+#endif
+  FrameAllocations(const FrameAllocations &) = delete;
+  FrameAllocations &operator=(const FrameAllocations &) = delete;
+
+private:
+#ifdef TRACK_ALLOCATIONS
+  Subsystem subsystem;
+  std::uint64_t start;
+#endif
+};
+
+#endif // ALLOCTRACKER_H
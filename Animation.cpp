@@ -0,0 +1,145 @@
+#include "Animation.h"
+#include <chrono>
+#include <ncurses.h>
+
+Sprite::Sprite(const char *art) {
+  std::string line;
+  for (const char *p = art;; ++p) {
+    if (*p == '\n' || *p == '\0') {
+      if ((int)line.size() > width)
+        width = (int)line.size();
+      lines.push_back(line);
+      line.clear();
+      if (*p == '\0')
+        break;
+    } else {
+      line += *p;
+    }
+  }
+  height = (int)lines.size();
+}
+
+char Sprite::at(int col, int row) const {
+  if (row < 0 || row >= height || col < 0 || col >= (int)lines[row].size())
+    return ' ';
+  return lines[row][col];
+}
+
+const Sprite &dolphinSprite() {
+  // Crying Dolphin ASCII
+  static const Sprite sprite("          ,\n"
+                             "      __)\\_  \n"
+                             "(\\_.-'    a`-.\n"
+                             "(/~~````(/~^^`");
+  return sprite;
+}
+
+const Sprite &catSprite() {
+  // Simple cat ASCII
+  static const Sprite sprite(
+      "      |\\      _,,,---,,_\nZZZzz /,`.-'`'    -.  ;-;;,_\n     |,4-  ) "
+      ")-,_. ,\\ (  `'-'\n    '---''(_/--'  `-'\\_)");
+  return sprite;
+}
+
+Animation::Animation(int frameMs)
+    : frameMs(frameMs), frame(0), nextFrameMs(0), done(false) {}
+
+Animation::~Animation() {}
+
+std::uint64_t Animation::nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Animation::start(std::uint64_t now) {
+  frame = 0;
+  done = !drawFrame(frame, true);
+  nextFrameMs = now + frameMs;
+}
+
+bool Animation::update(std::uint64_t now) {
+  if (done || now < nextFrameMs)
+    return false;
+  std::uint64_t behind = (now - nextFrameMs) / frameMs;
+  frame += 1 + (int)behind;
+  nextFrameMs += (behind + 1) * frameMs;
+  done = !drawFrame(frame, false);
+  return true;
+}
+
+void Animation::redraw() {
+  if (!done)
+    done = !drawFrame(frame, true);
+}
+
+int Animation::msUntilDue(std::uint64_t now) const {
+  if (done)
+    return -1;
+  return now >= nextFrameMs ? 0 : (int)(nextFrameMs - now);
+}
+
+bool Animation::finished() const { return done; }
+
+void Animation::eraseRect(const Rect &rect, const Sprite *background,
+                          int backgroundX, int backgroundY) {
+  for (int row = rect.y; row < rect.y + rect.h; ++row)
+    for (int col = rect.x; col < rect.x + rect.w; ++col) {
+      char c = ' ';
+      if (background != nullptr)
+        c = background->at(col - backgroundX, row - backgroundY);
+      mvaddch(row, col, c);
+    }
+}
+
+Rect Animation::drawSprite(const Sprite &sprite, int x, int y,
+                           int screenWidth) {
+  // Clip horizontally so lines never wrap onto the next row.
+  int left = x < 0 ? 0 : x;
+  int right = x + sprite.width < screenWidth ? x + sprite.width : screenWidth;
+  Rect drawn;
+  drawn.x = left;
+  drawn.y = y;
+  drawn.w = right > left ? right - left : 0;
+  drawn.h = sprite.height;
+  for (int row = 0; row < sprite.height; ++row) {
+    const std::string &line = sprite.lines[row];
+    int from = left - x;
+    int to = right - x < (int)line.size() ? right - x : (int)line.size();
+    if (to > from)
+      mvaddnstr(y + row, left, line.c_str() + from, to - from);
+  }
+  return drawn;
+}
+
+TearsAnimation::TearsAnimation(int dolphinX, int dolphinY)
+    : Animation(200), dolphinX(dolphinX), dolphinY(dolphinY) {}
+
+bool TearsAnimation::drawFrame(int frame, bool screenCleared) {
+  static const char tears[] = {'.', 'o', 'O', '.'};
+  if (!screenCleared)
+    eraseRect(lastTear, &dolphinSprite(), dolphinX, dolphinY);
+  int step = frame % 4;
+  lastTear.x = dolphinX + 12;
+  lastTear.y = dolphinY + 2 + step;
+  lastTear.w = 1;
+  lastTear.h = 1;
+  mvaddch(lastTear.y, lastTear.x, tears[step]);
+  return true;
+}
+
+WalkingCatAnimation::WalkingCatAnimation(int y, int screenWidth)
+    : Animation(100), y(y), screenWidth(screenWidth) {}
+
+bool WalkingCatAnimation::drawFrame(int frame, bool screenCleared) {
+  if (!screenCleared)
+    eraseRect(lastCat);
+  int x = -20 + frame * 2;
+  if (x >= screenWidth) {
+    lastCat = Rect();
+    return false;
+  }
+  lastCat = drawSprite(catSprite(), x, y, screenWidth);
+  return true;
+}
@@ -0,0 +1,87 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ASCII art split into lines once, so drawing a frame never has to parse it.
+struct Sprite {
+  std::vector<std::string> lines;
+  int width = 0; // Widest line, in columns
+  int height = 0;
+
+  explicit Sprite(const char *art);
+  char at(int col, int row) const; // ' ' outside the art
+};
+
+const Sprite &dolphinSprite();
+const Sprite &catSprite();
+
+struct Rect {
+  int x = 0, y = 0, w = 0, h = 0;
+};
+
+// A cooperative animation task. The main loop asks how long it may wait
+// (msUntilDue), then calls update(); frames advance on the monotonic clock,
+// so a late update skips straight to the current frame. Each frame repaints
+// only the cells the previous frame covered and the ones the new frame covers.
+class Animation {
+public:
+  explicit Animation(int frameMs);
+  virtual ~Animation();
+
+  static std::uint64_t nowMs();
+
+  void start(std::uint64_t now); // Draws frame 0
+  // Returns true if something was drawn.
+  bool update(std::uint64_t now);
+  // Draws the current frame again, e.g. after the screen was cleared.
+  void redraw();
+  int msUntilDue(std::uint64_t now) const; // -1 once finished
+  bool finished() const;
+
+protected:
+  // Draws `frame`, erasing the previous one. Returns false when the
+  // animation has run its course.
+  virtual bool drawFrame(int frame, bool screenCleared) = 0;
+
+  static void eraseRect(const Rect &rect, const Sprite *background = nullptr,
+                        int backgroundX = 0, int backgroundY = 0);
+  static Rect drawSprite(const Sprite &sprite, int x, int y, int screenWidth);
+
+private:
+  int frameMs;
+  int frame;
+  std::uint64_t nextFrameMs;
+  bool done;
+};
+
+// Tears dripping from the dolphin on the game over screen; runs until the
+// screen is left.
+class TearsAnimation : public Animation {
+public:
+  TearsAnimation(int dolphinX, int dolphinY);
+
+protected:
+  bool drawFrame(int frame, bool screenCleared) override;
+
+private:
+  int dolphinX, dolphinY;
+  Rect lastTear;
+};
+
+// The cat strolling across the level complete screen, left to right.
+class WalkingCatAnimation : public Animation {
+public:
+  WalkingCatAnimation(int y, int screenWidth);
+
+protected:
+  bool drawFrame(int frame, bool screenCleared) override;
+
+private:
+  int y, screenWidth;
+  Rect lastCat;
+};
+
+#endif // ANIMATION_H
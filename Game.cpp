@@ -1,14 +1,60 @@
 #include "Game.h"
-#include <unistd.h>
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "Tracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+static const float kDefaultReviewRate = 0.25f;
+// A correct answer given with less than this much time left counts as slow.
+static const float kSlowAnswerTimeLeft = 0.5f;
+// Logic ticks at a fixed 60 Hz; timeDecay is expressed per tick.
+static const std::chrono::microseconds kTickInterval(16667);
+// How long the render thread waits for a key before checking for a new frame.
+static const int kInputPollMs = 4;
+
+ProblemView FrameSnapshot::problem() const {
+  ProblemView view{};
+  view.question = std::string_view(question, questionLength);
+  view.options = options;
+  return view;
+}
 
 Game::Game()
     : isRunning(true), inMenu(true), inLevelTransition(false),
-      isGameOver(false), score(0), level(1), challengesPassed(0),
-      timeLeft(1.0f), timeDecay(0.00083f), difficulty(Difficulty::EASY),
-      language("English") {
+      isGameOver(false), inSettings(false), hasUI(true),
+      seatScreen(SeatScreen::NONE), score(0), level(1), challengesPassed(0),
+      bankIndex(0), problemShownMs(0), timeLeft(1.0f), timeDecay(0.00083f),
+      difficulty(Difficulty::EASY),
+      language("English"), logicRunning(false) {
   ui.init(); // Init ncurses first to be safe, though loadLanguage doesn't need
              // it, but good practice
+  const char *user = std::getenv("USER");
+  setUp(user != nullptr ? user : "player");
+}
+
+Game::Game(const char *type, FILE *out, FILE *in, const std::string &player)
+    : isRunning(true), inMenu(true), inLevelTransition(false),
+      isGameOver(false), inSettings(false), hasUI(false),
+      seatScreen(SeatScreen::NONE), score(0), level(1), challengesPassed(0),
+      bankIndex(0), problemShownMs(0), timeLeft(1.0f), timeDecay(0.00083f),
+      difficulty(Difficulty::EASY),
+      language("English"), logicRunning(false) {
+  hasUI = ui.initTerminal(type, out, in);
+  setUp(player);
+}
+
+void Game::setUp(const std::string &player) {
   ui.loadLanguage(language);
+  mathGen.setReviewScheduler(&reviews, kDefaultReviewRate);
+  mathGen.setSessionFilter(&recentProblems);
+
+  // The leaderboard is best effort: the game runs fine without it.
+  if (scoreboard.open())
+    scoreboard.join(player);
 }
 
 void Game::run() {
@@ -18,53 +64,45 @@ void Game::run() {
 
   while (isRunning) {
     if (inMenu) {
-      MenuOption opt = ui.showMainMenu();
+      MenuOption opt;
+      {
+        TraceScope trace("showMainMenu", "ui");
+        opt = ui.showMainMenu();
+      }
       if (opt == MenuOption::START_GAME) {
-        inMenu = false;
         ui.setNonBlocking(true); // Enable non-blocking for game
-        reset();
+        startGame();
       } else if (opt == MenuOption::SETTINGS) {
-        ui.showSettings(difficulty, language);
-        mathGen.setDifficulty(difficulty);
+        TraceScope trace("showSettings", "ui");
+        std::string selectedBank = bankName;
+        ui.showSettings(difficulty, language, ProblemBank::list(),
+                        selectedBank);
+        applySettings(selectedBank);
       } else if (opt == MenuOption::EXIT) {
         isRunning = false;
       }
     } else if (isGameOver) {
-      ui.showGameOver(score, level);
-      // Check if user wants to restart or quit is handled inside showGameOver
-      // loop or we just reset here if they return Actually showGameOver returns
-      // when space is pressed (restart) or Q (quit). For simplicity, let's
-      // assume it returns on restart request, or we can check input there.
-      // Let's just reset to menu for now.
-      inMenu = true;
-      isGameOver = false;
+      if (!ui.inAnimatedScreen())
+        ui.beginGameOver(score, level);
+      int ch;
+      {
+        TraceScope trace("gameOverFrame", "ui");
+        ch = ui.pollAnimatedScreen();
+      }
+      gameOverKey(ch);
     } else if (inLevelTransition) {
-      ui.showLevelComplete(level);
-      int ch = ui.getInput();
-      if (ch == ' ') {
-        inLevelTransition = false;
-        // Start next level logic
-        level++;
-        mathGen.startNewLevel(); // Reset unique operands for new level
-
-        // Duration: 20s, 17.5s, 15s... (-2.5s per level)
-        float duration = 20.0f - (level - 1) * 2.5f;
-        if (duration < 3.0f)
-          duration = 3.0f;
-        timeDecay = 1.0f / (duration * 60.0f);
-
-        // Reset timer for new level
-        timeLeft = 1.0f;
-        // Generate new problem? Already generated after last success?
-        // We generated a problem after success, but maybe we should regenerate
-        // or keep it. Keeping it is fine.
+      if (!ui.inAnimatedScreen())
+        ui.beginLevelComplete(level);
+      int ch;
+      {
+        TraceScope trace("levelCompleteFrame", "ui");
+        ch = ui.pollAnimatedScreen();
       }
+      levelCompleteKey(ch);
+      if (inMenu)
+        ui.setNonBlocking(false);
     } else {
-      handleInput();
-      update();
-      ui.drawGame(score, level, challengesPassed, currentProblem, timeLeft,
-                  ui.getScreenWidth(), ui.getScreenHeight());
-      usleep(16000); // ~60 FPS
+      runGameplay();
     }
   }
 
@@ -79,12 +117,222 @@ void Game::reset() {
   timeDecay =
       0.00083f; // Initial decay speed for 20s: 1.0 / (20 * 60) ~= 0.000833
   mathGen.setDifficulty(difficulty);
-  currentProblem = mathGen.generateProblem(0, challengesPassed);
+  mathGen.startNewLevel(); // Operands used in the last game are free again
+  bankIndex = 0;
+  nextProblem(0);
+  scoreboard.publish(level, score, challengesPassed);
+  Metrics::levelReached(level);
+}
+
+void Game::startGame() {
+  inMenu = false;
+  Tracer::instant("game", "state");
+  reset();
+}
+
+void Game::applySettings(const std::string &selectedBank) {
+  mathGen.setDifficulty(difficulty);
+  selectBank(selectedBank);
+}
+
+void Game::gameOverKey(int ch) {
+  // Space restarts from the menu, Q quits to it; both end up there.
+  if (ch == ' ' || ch == 'q' || ch == 'Q') {
+    ui.endAnimatedScreen();
+    inMenu = true;
+    isGameOver = false;
+    Tracer::instant("menu", "state");
+  }
+}
+
+void Game::levelCompleteKey(int ch) {
+  if (ch == 'q' || ch == 'Q') {
+    ui.endAnimatedScreen();
+    inLevelTransition = false;
+    inMenu = true;
+    Tracer::instant("menu", "state");
+  } else if (ch == ' ') {
+    ui.endAnimatedScreen();
+    inLevelTransition = false;
+    Tracer::instant("game", "state");
+    // Start next level logic
+    level++;
+    mathGen.startNewLevel(); // Reset unique operands for new level
+    scoreboard.publish(level, score, challengesPassed);
+    Metrics::levelReached(level);
+
+    // Duration: 20s, 17.5s, 15s... (-2.5s per level)
+    float duration = 20.0f - (level - 1) * 2.5f;
+    if (duration < 3.0f)
+      duration = 3.0f;
+    timeDecay = 1.0f / (duration * 60.0f);
+
+    // Reset timer for new level. The level's first problem was not generated
+    // with the last answer, so a seeded game asks problemAt(level, 10 * n).
+    timeLeft = 1.0f;
+    nextProblem(currentProblem.correctAnswer);
+  }
+}
+
+bool Game::hasTerminal() const { return hasUI; }
+
+void Game::start() {
+  ui.makeCurrent();
+  showSeatScreen();
+}
+
+void Game::pollInput() {
+  ui.makeCurrent();
+  int ch;
+  while ((ch = ui.getInput()) != ERR)
+    seatKey(ch);
+  showSeatScreen();
+}
+
+bool Game::needsTicks() const { return inGameplay() || ui.inAnimatedScreen(); }
+
+void Game::tick() {
+  if (!needsTicks())
+    return;
+  TraceScope trace("tick", "game");
+  ui.makeCurrent();
+  if (inGameplay())
+    update();
+  else
+    ui.stepAnimation();
+  showSeatScreen();
+}
+
+void Game::seatKey(int ch) {
+  MenuOption option;
+  switch (seatScreen) {
+  case SeatScreen::MAIN_MENU:
+    if (!ui.mainMenuKey(ch, option))
+      break;
+    if (option == MenuOption::START_GAME)
+      startGame();
+    else if (option == MenuOption::SETTINGS)
+      inSettings = true;
+    else
+      seatScreen = SeatScreen::NONE; // A seat never exits; show a fresh menu
+    break;
+  case SeatScreen::SETTINGS: {
+    std::string selectedBank = bankName;
+    if (ui.settingsKey(ch, difficulty, language, selectedBank)) {
+      applySettings(selectedBank);
+      inSettings = false;
+    }
+    break;
+  }
+  case SeatScreen::GAME_OVER:
+    gameOverKey(ch);
+    break;
+  case SeatScreen::LEVEL_COMPLETE:
+    levelCompleteKey(ch);
+    break;
+  case SeatScreen::GAMEPLAY:
+    handleKey(ch);
+    break;
+  case SeatScreen::NONE:
+    break;
+  }
 }
 
-void Game::handleInput() {
-  int ch = ui.getInput();
-  if (ch != ERR) {
+// Starts whichever screen the state of a kiosk seat now calls for, and draws
+// gameplay frames.
+void Game::showSeatScreen() {
+  SeatScreen screen = SeatScreen::GAMEPLAY;
+  if (inMenu)
+    screen = inSettings ? SeatScreen::SETTINGS : SeatScreen::MAIN_MENU;
+  else if (isGameOver)
+    screen = SeatScreen::GAME_OVER;
+  else if (inLevelTransition)
+    screen = SeatScreen::LEVEL_COMPLETE;
+
+  if (screen != seatScreen) {
+    ui.endAnimatedScreen();
+    seatScreen = screen;
+    switch (screen) {
+    case SeatScreen::MAIN_MENU:
+      ui.beginMainMenu();
+      break;
+    case SeatScreen::SETTINGS:
+      ui.beginSettings(difficulty, language, ProblemBank::list(), bankName);
+      break;
+    case SeatScreen::GAME_OVER:
+      ui.beginGameOver(score, level);
+      break;
+    case SeatScreen::LEVEL_COMPLETE:
+      ui.beginLevelComplete(level);
+      break;
+    default:
+      break;
+    }
+  }
+  if (screen == SeatScreen::GAMEPLAY)
+    ui.drawGame(score, level, challengesPassed, currentProblem, timeLeft);
+  ui.present();
+}
+
+void Game::setSeed(std::uint64_t seed) { mathGen.setSeed(seed); }
+
+void Game::setReviewRate(float rate) {
+  mathGen.setReviewScheduler(&reviews, rate);
+}
+
+void Game::setRepeatWindow(std::size_t problems) {
+  if (problems == 0) {
+    mathGen.setSessionFilter(nullptr);
+    return;
+  }
+  recentProblems = ProblemFilter(problems);
+  mathGen.setSessionFilter(&recentProblems);
+}
+
+void Game::setRules(const GenerationRules &rules) { mathGen.setRules(rules); }
+
+void Game::setLanguage(const std::string &lang) {
+  language = lang;
+  ui.loadLanguage(language);
+}
+
+Fact Game::currentFact() const {
+  return ReviewScheduler::normalize(currentProblem.op, currentProblem.operandA,
+                                    currentProblem.operandB);
+}
+
+void Game::nextProblem(int previousResult) {
+  TraceScope trace("generateProblem", "generator");
+  if (bank.isOpen()) {
+    // Curated banks play in order and start over when exhausted.
+    currentProblem = bank.at(bankIndex++ % bank.size());
+  } else {
+    if (mathGen.isSeeded())
+      generatedProblem = mathGen.problemAt(level, challengesPassed);
+    else
+      generatedProblem =
+          mathGen.generateProblem(previousResult, challengesPassed);
+    currentProblem = generatedProblem.view();
+  }
+  problemShownMs = ReviewScheduler::nowMs();
+  Metrics::problemGenerated(difficulty, currentProblem.op);
+}
+
+void Game::selectBank(const std::string &name) {
+  if (name == bankName)
+    return;
+  bank.close();
+  bankName.clear();
+  if (name.empty())
+    return;
+  if (bank.open(ProblemBank::pathFor(name)) && bank.size() > 0)
+    bankName = name;
+  else
+    bank.close();
+}
+
+void Game::handleKey(int ch) {
+  {
     int chosenOption = -1;
     switch (ch) {
     case KEY_LEFT:
@@ -98,33 +346,45 @@ void Game::handleInput() {
       break;
     case 'q':
     case 'Q':
-      inMenu = true;            // Quit to menu
-      ui.setNonBlocking(false); // Disable non-blocking for menu
+      inMenu = true; // Quit to menu; runGameplay() restores blocking input
+      Tracer::instant("menu", "state");
       return;
     }
 
     if (chosenOption != -1) {
+      std::uint64_t now = ReviewScheduler::nowMs();
+      bool correct = currentProblem.options[chosenOption] ==
+                     currentProblem.correctAnswer;
+      Metrics::answer(difficulty, currentProblem.op,
+                      correct ? AnswerOutcome::CORRECT : AnswerOutcome::WRONG,
+                      now - problemShownMs);
       // Immediate validation
-      if (currentProblem.options[chosenOption] ==
-          currentProblem.correctAnswer) {
+      if (correct) {
         // Correct
+        if (timeLeft < kSlowAnswerTimeLeft)
+          reviews.recordSlow(currentFact(), now);
+        else
+          reviews.recordCorrect(currentFact(), now);
         score += 10 * level;
         challengesPassed++;
+        scoreboard.publish(level, score, challengesPassed);
 
         if (challengesPassed % 10 == 0) {
           inLevelTransition = true;
+          Tracer::instant("level_transition", "state");
           // Don't increment level yet, wait for transition
           // But we need to show "Level X Completed" or "Ready for Level X+1"?
           // Let's say "Level X Completed! Press Space for Level X+1"
         } else {
           // Normal problem generation
-          currentProblem = mathGen.generateProblem(currentProblem.correctAnswer,
-                                                   challengesPassed);
+          nextProblem(currentProblem.correctAnswer);
           timeLeft = 1.0f;
         }
       } else {
         // Wrong
+        reviews.recordMiss(currentFact(), now);
         isGameOver = true;
+        Tracer::instant("game_over", "state");
       }
     }
   }
@@ -135,6 +395,104 @@ void Game::update() {
 
   if (timeLeft <= 0.0f) {
     // Time out
+    std::uint64_t now = ReviewScheduler::nowMs();
+    reviews.recordMiss(currentFact(), now);
+    Metrics::answer(difficulty, currentProblem.op, AnswerOutcome::TIMEOUT,
+                    now - problemShownMs);
     isGameOver = true;
+    Tracer::instant("game_over", "state");
   }
 }
+
+bool Game::inGameplay() const {
+  return !inMenu && !isGameOver && !inLevelTransition;
+}
+
+void Game::runGameplay() {
+  int ch;
+  while (keys.pop(ch)) {
+    // Drop keys left over from the previous round
+  }
+  publishFrame(); // Replaces any undrawn frame from the previous round
+
+  logicRunning.store(true, std::memory_order_release);
+  std::thread logic(&Game::logicLoop, this);
+
+  ui.setInputTimeout(kInputPollMs);
+  FrameSnapshot last{};
+  bool haveFrame = false;
+  while (logicRunning.load(std::memory_order_acquire)) {
+    bool redraw = false;
+    ch = ui.getInput();
+    if (ch == KEY_RESIZE)
+      redraw = haveFrame;
+    else if (ch != ERR)
+      keys.push(ch);
+
+    if (const FrameSnapshot *frame = frames.consume()) {
+      last = *frame;
+      haveFrame = redraw = true;
+    }
+    if (!redraw)
+      continue;
+
+    TraceScope frame("frame", "ui");
+    AllocScope allocScope(Subsystem::UI);
+    FrameAllocations frameAllocations(Subsystem::UI);
+    auto frameStart = std::chrono::steady_clock::now();
+    {
+      TraceScope trace("drawGame", "ui");
+      ui.drawGame(last.score, last.level, last.challengesPassed,
+                  last.problem(), last.timeLeft);
+    }
+    {
+      TraceScope trace("refresh", "ui");
+      ui.present();
+    }
+    Metrics::frameTime(std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - frameStart)
+                           .count());
+  }
+  logic.join();
+
+  ui.setNonBlocking(!inMenu); // The game over and level screens poll
+}
+
+void Game::logicLoop() {
+  auto nextTick = std::chrono::steady_clock::now();
+  while (inGameplay()) {
+    {
+      TraceScope tick("tick", "game");
+      AllocScope allocScope(Subsystem::GAME_LOOP);
+      FrameAllocations tickAllocations(Subsystem::GAME_LOOP);
+      {
+        TraceScope trace("input", "game");
+        int ch;
+        while (inGameplay() && keys.pop(ch))
+          handleKey(ch);
+      }
+      if (inGameplay()) {
+        TraceScope trace("update", "game");
+        update();
+      }
+      publishFrame();
+    }
+    nextTick += kTickInterval;
+    std::this_thread::sleep_until(nextTick);
+  }
+  logicRunning.store(false, std::memory_order_release);
+}
+
+void Game::publishFrame() {
+  FrameSnapshot &frame = frames.back();
+  frame.score = score;
+  frame.level = level;
+  frame.challengesPassed = challengesPassed;
+  frame.timeLeft = timeLeft;
+  std::copy(currentProblem.options, currentProblem.options + 3, frame.options);
+  frame.questionLength = (int)std::min<std::size_t>(
+      currentProblem.question.size(), FrameSnapshot::kMaxQuestion);
+  std::memcpy(frame.question, currentProblem.question.data(),
+              frame.questionLength);
+  frames.publish();
+}
@@ -2,31 +2,101 @@
 #define GAME_H
 
 #include "MathGenerator.h"
+#include "ProblemBank.h"
+#include "ProblemFilter.h"
+#include "ReviewScheduler.h"
+#include "Scoreboard.h"
+#include "SpscRing.h"
+#include "TripleBuffer.h"
 #include "UI.h"
+#include <atomic>
+
+// Everything the renderer needs to draw one gameplay frame, copied out of the
+// game state by the logic thread so the two never share mutable data.
+struct FrameSnapshot {
+  static const int kMaxQuestion = 128;
+
+  int score;
+  int level;
+  int challengesPassed;
+  float timeLeft;
+  int options[3];
+  char question[kMaxQuestion];
+  int questionLength;
+
+  ProblemView problem() const;
+};
 
 class Game {
 public:
   Game();
+  // A kiosk seat: plays on the terminal `out`/`in` of terminfo `type`, listed
+  // in the leaderboard as `player`. Kiosk drives it through start(),
+  // pollInput() and tick() instead of run().
+  Game(const char *type, FILE *out, FILE *in, const std::string &player);
   void run();
+  void setSeed(std::uint64_t seed); // Same seed, same problem sequence
+  void setReviewRate(float rate);   // Share of problems that are reviews
+  void setRepeatWindow(std::size_t problems); // 0 allows repeats
+  void setRules(const GenerationRules &rules);
+  void setLanguage(const std::string &lang); // Until changed in Settings
+
+  // Kiosk seats. Nothing here blocks: start() shows the main menu,
+  // pollInput() handles the keys waiting on the terminal and tick() advances
+  // one 60 Hz logic tick. needsTicks() is false while ticks would do nothing.
+  bool hasTerminal() const;
+  void start();
+  void pollInput();
+  void tick();
+  bool needsTicks() const;
+  const ProblemView &shownProblem() const { return currentProblem; }
 
 private:
+  enum class SeatScreen { NONE, MAIN_MENU, SETTINGS, GAMEPLAY, GAME_OVER,
+                          LEVEL_COMPLETE };
+
+  void setUp(const std::string &player);
   void reset();
+  void startGame();
+  void applySettings(const std::string &selectedBank);
+  void gameOverKey(int ch);
+  void levelCompleteKey(int ch);
+  void seatKey(int ch);
+  void showSeatScreen();
+  void nextProblem(int previousResult);
+  void selectBank(const std::string &name);
+  Fact currentFact() const;
   void update();
-  void handleInput();
+  void handleKey(int ch);
+  bool inGameplay() const;
+  void runGameplay();
+  void logicLoop();
+  void publishFrame();
 
   UI ui;
   MathGenerator mathGen;
+  ReviewScheduler reviews; // Missed and slow facts of this learner
+  Scoreboard scoreboard;   // This session's row in the shared leaderboard
+  ProblemFilter recentProblems; // Problems shown since the program started
 
   bool isRunning;
   bool inMenu;
   bool inLevelTransition;
   bool isGameOver;
+  bool inSettings;       // Kiosk seats only; run() shows settings in one call
+  bool hasUI;            // False if a seat's terminal could not be set up
+  SeatScreen seatScreen; // What a kiosk seat's terminal shows
 
   int score;
   int level;
   int challengesPassed;
 
-  MathProblem currentProblem;
+  ProblemView currentProblem;    // Into generatedProblem or the bank
+  MathProblem generatedProblem;  // Storage when the generator is the source
+  ProblemBank bank;              // Curated problems, when one is selected
+  std::string bankName;          // Empty: use the generator
+  std::size_t bankIndex;
+  std::uint64_t problemShownMs; // When currentProblem appeared (answer latency)
 
   // Game State
   float timeLeft;  // 0.0 to 1.0 (normalized)
@@ -34,6 +104,13 @@ private:
 
   Difficulty difficulty;
   std::string language;
+
+  // Gameplay runs the logic on its own fixed-rate thread (logicLoop) while
+  // the main thread reads keys and draws. Keys go one way through `keys`,
+  // finished frames the other way through `frames`.
+  SpscRing<int, 64> keys;
+  TripleBuffer<FrameSnapshot> frames;
+  std::atomic<bool> logicRunning;
 };
 
 #endif // GAME_H
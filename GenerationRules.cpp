@@ -0,0 +1,277 @@
+#include "GenerationRules.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+static const char *const kDefaultRules = R"(# Problem generation rules, one section per difficulty:
+#
+#   op  weight  a-range  [b-range]  [constraints]
+#
+# op is + - * / sqrt or cbrt; weights are relative within the section.
+# For / the a-range is the answer (the dividend is answer * b); for sqrt and
+# cbrt it is the root and there is no b-range. Constraints:
+#   chain          start from the previous answer when there is one and no
+#                  b in range can overflow the result
+#   chain>=N       ... but only when it is at least N
+#   unique_b       b does not repeat within a level
+#   fallback=L..H  (/ only) when the previous answer is not divisible by b,
+#                  ask + or - with b in L..H instead
+#
+# Ranges lie within -1000000..1000000, and for * and / the largest product
+# (or dividend) must fit in a 32-bit int.
+
+[easy]
++     1  10..99  10..30  chain>=10 unique_b
+
+[medium]
++     1  10..99  10..30  chain>=10 unique_b
+-     1  10..99  10..30  chain>=10 unique_b
+
+[hard]
++     1  10..99  10..30  chain>=10 unique_b
+-     1  10..99  10..30  chain>=10 unique_b
+*     1  2..12   2..12   chain
+
+[expert]
++     1  10..99  10..40  chain>=10 unique_b
+-     1  10..99  10..40  chain>=10 unique_b
+*     1  2..12   2..12   chain
+/     1  2..12   2..10   chain fallback=1..20
+
+[master]
++     2  10..99  10..50  chain>=10 unique_b
+-     2  10..99  10..50  chain>=10 unique_b
+*     2  2..12   2..12   chain
+/     2  2..12   2..10   chain fallback=1..20
+sqrt  1  2..20
+cbrt  1  2..10
+)";
+
+static const char *const kSectionNames[GenerationRules::kDifficulties] = {
+    "easy", "medium", "hard", "expert", "master"};
+
+// Roots above these overflow an int once squared or cubed.
+static const int kMaxSquareRoot = 46340;
+static const int kMaxCubeRoot = 1290;
+// Bound on every range, so sums and differences of operands cannot overflow.
+static const int kMaxOperand = 1000000;
+
+static bool parseInt(const std::string &text, int &value) {
+  if (text.empty())
+    return false;
+  char *end = nullptr;
+  long v = std::strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || v < INT_MIN || v > INT_MAX)
+    return false;
+  value = (int)v;
+  return true;
+}
+
+// "L..H" with -kMaxOperand <= L <= H <= kMaxOperand.
+static bool parseRange(const std::string &text, int &min, int &max) {
+  std::size_t dots = text.find("..");
+  return dots != std::string::npos && parseInt(text.substr(0, dots), min) &&
+         parseInt(text.substr(dots + 2), max) && min <= max &&
+         min >= -kMaxOperand && max <= kMaxOperand;
+}
+
+static long long largestMagnitude(int min, int max) {
+  return std::max(std::llabs(min), std::llabs(max));
+}
+
+// Parses one rule line; returns an empty string or what is wrong with it.
+static std::string parseRule(const std::vector<std::string> &tokens,
+                             OperatorRule &rule) {
+  const std::string &op = tokens[0];
+  if (op == "sqrt")
+    rule.op = 's';
+  else if (op == "cbrt")
+    rule.op = 'c';
+  else if (op == "+" || op == "-" || op == "*" || op == "/")
+    rule.op = op[0];
+  else
+    return "unknown operator '" + op + "'";
+  bool root = rule.op == 's' || rule.op == 'c';
+
+  if (tokens.size() < 3 || !parseInt(tokens[1], rule.weight) ||
+      rule.weight <= 0 || rule.weight > 1000000)
+    return "expected a weight between 1 and 1000000";
+  if (!parseRange(tokens[2], rule.aMin, rule.aMax))
+    return "expected an a-range such as 10..99 (within +-1000000)";
+
+  std::size_t next = 3;
+  if (!root) {
+    if (tokens.size() < 4 || !parseRange(tokens[3], rule.bMin, rule.bMax))
+      return "expected a b-range such as 10..30 (within +-1000000)";
+    next = 4;
+  }
+
+  for (; next < tokens.size(); ++next) {
+    const std::string &c = tokens[next];
+    if (c == "chain") {
+      rule.chain = true;
+      rule.chainMin = INT_MIN;
+    } else if (c.compare(0, 7, "chain>=") == 0) {
+      rule.chain = true;
+      if (!parseInt(c.substr(7), rule.chainMin))
+        return "bad constraint '" + c + "'";
+    } else if (c == "unique_b" && !root) {
+      rule.uniqueB = true;
+    } else if (c.compare(0, 9, "fallback=") == 0 && rule.op == '/') {
+      rule.fallback = true;
+      if (!parseRange(c.substr(9), rule.fallbackMin, rule.fallbackMax))
+        return "bad constraint '" + c + "'";
+    } else {
+      return "unknown constraint '" + c + "' for " + op;
+    }
+  }
+
+  if (root && rule.chain)
+    return "sqrt and cbrt cannot chain";
+  if (rule.op == '/' && rule.bMin <= 0)
+    return "divisors must be positive";
+  if ((rule.op == 's' && (rule.aMin < 0 || rule.aMax > kMaxSquareRoot)) ||
+      (rule.op == 'c' && (rule.aMin < 0 || rule.aMax > kMaxCubeRoot)))
+    return "root out of range";
+  if ((rule.op == '*' || rule.op == '/') &&
+      largestMagnitude(rule.aMin, rule.aMax) *
+              largestMagnitude(rule.bMin, rule.bMax) >
+          INT_MAX)
+    return "products of these ranges overflow";
+  return "";
+}
+
+GenerationRules::GenerationRules() {
+  std::string error;
+  parse(kDefaultRules, error);
+}
+
+const char *GenerationRules::defaultText() { return kDefaultRules; }
+
+bool GenerationRules::parse(const std::string &text, std::string &error) {
+  Table parsed[kDifficulties];
+  int section = -1;
+  std::istringstream in(text);
+  std::string line;
+  for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+    std::string where = "rules:" + std::to_string(lineNumber) + ": ";
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::vector<std::string> tokens;
+    for (std::string word; words >> word;)
+      tokens.push_back(word);
+    if (tokens.empty())
+      continue;
+
+    if (tokens[0].front() == '[') {
+      section = -1;
+      for (int d = 0; d < kDifficulties; ++d)
+        if (tokens[0] == "[" + std::string(kSectionNames[d]) + "]")
+          section = d;
+      if (section < 0 || tokens.size() != 1) {
+        error = where + "unknown section " + tokens[0];
+        return false;
+      }
+      continue;
+    }
+    if (section < 0) {
+      error = where + "rule outside a [difficulty] section";
+      return false;
+    }
+    Table &table = parsed[section];
+    if (table.count == kMaxOperators) {
+      error = where + "too many rules for " + kSectionNames[section];
+      return false;
+    }
+    OperatorRule rule;
+    std::string problem = parseRule(tokens, rule);
+    if (!problem.empty()) {
+      error = where + problem;
+      return false;
+    }
+    table.rules[table.count++] = rule;
+  }
+
+  for (int d = 0; d < kDifficulties; ++d) {
+    if (parsed[d].count == 0) {
+      error = std::string("rules: no rules for ") + kSectionNames[d];
+      return false;
+    }
+    compile(parsed[d]);
+  }
+  for (int d = 0; d < kDifficulties; ++d)
+    tables[d] = parsed[d];
+  return true;
+}
+
+bool GenerationRules::load(const std::string &path, std::string &error) {
+  std::ifstream file(path);
+  if (!file) {
+    error = "cannot read " + path;
+    return false;
+  }
+  std::stringstream text;
+  text << file.rdbuf();
+  if (parse(text.str(), error))
+    return true;
+  error = path + error.substr(error.find(':')); // Name the file, not "rules"
+  return false;
+}
+
+// Vose's alias method in integer arithmetic. Each column holds 1/n of the
+// probability mass: the share of its own operator (threshold) and the rest
+// of one heavier operator (alias).
+void GenerationRules::compile(Table &table) {
+  int n = table.count;
+  std::uint64_t total = 0;
+  for (int i = 0; i < n; ++i)
+    total += table.rules[i].weight;
+
+  // Masses are scaled by n * kCoinScale * total so they stay integers; a
+  // column is full at kCoinScale * total.
+  const std::uint64_t full = (std::uint64_t)kCoinScale * total;
+  std::uint64_t mass[kMaxOperators];
+  int small[kMaxOperators], large[kMaxOperators];
+  int smallCount = 0, largeCount = 0;
+  for (int i = 0; i < n; ++i) {
+    mass[i] = (std::uint64_t)table.rules[i].weight * n * kCoinScale;
+    if (mass[i] < full)
+      small[smallCount++] = i;
+    else
+      large[largeCount++] = i;
+  }
+  while (smallCount > 0 && largeCount > 0) {
+    int less = small[--smallCount];
+    int more = large[--largeCount];
+    table.threshold[less] = (std::uint32_t)(mass[less] / total);
+    table.alias[less] = (std::uint8_t)more;
+    mass[more] -= full - mass[less];
+    if (mass[more] < full)
+      small[smallCount++] = more;
+    else
+      large[largeCount++] = more;
+  }
+  // Whatever is left is full up to rounding.
+  while (largeCount > 0) {
+    int i = large[--largeCount];
+    table.threshold[i] = kCoinScale;
+    table.alias[i] = (std::uint8_t)i;
+  }
+  while (smallCount > 0) {
+    int i = small[--smallCount];
+    table.threshold[i] = kCoinScale;
+    table.alias[i] = (std::uint8_t)i;
+  }
+}
+
+int GenerationRules::operatorCount(Difficulty difficulty) const {
+  return tables[(int)difficulty].count;
+}
+
+const OperatorRule &GenerationRules::rule(Difficulty difficulty,
+                                          int index) const {
+  return tables[(int)difficulty].rules[index];
+}
@@ -0,0 +1,69 @@
+#ifndef GENERATIONRULES_H
+#define GENERATIONRULES_H
+
+#include <cstdint>
+#include <string>
+
+enum class Difficulty;
+
+// How one operator is generated at one difficulty.
+struct OperatorRule {
+  char op = '+'; // + - * / s (sqrt) c (cbrt)
+  int weight = 1;
+  int aMin = 0, aMax = 0; // First operand; the answer for '/', the root for s/c
+  int bMin = 0, bMax = 0; // Second operand; unused for s/c
+  bool chain = false;     // Start from the previous answer when there is one
+  int chainMin = 0;       // ... but only when it is at least this
+  bool uniqueB = false;   // b does not repeat within a level
+  // '/' only: when the previous answer is not divisible by b, ask + or -
+  // with b in [fallbackMin, fallbackMax] instead.
+  bool fallback = false;
+  int fallbackMin = 0, fallbackMax = 0;
+};
+
+// Which operators each Difficulty asks, how often and with which operands,
+// read from a small text format (see defaultText()). Loading compiles the
+// weights of every difficulty into an alias table, so picking an operator is
+// one random draw and a table lookup whatever the weights are.
+class GenerationRules {
+public:
+  static const int kDifficulties = 5;
+  static const int kMaxOperators = 8; // Per difficulty
+
+  GenerationRules(); // The built-in rules
+  static const char *defaultText();
+
+  // Replace the rules; on error the current rules are kept.
+  bool parse(const std::string &text, std::string &error);
+  bool load(const std::string &path, std::string &error);
+
+  // Operator for `difficulty` from one non-negative random draw of at least
+  // 24 bits. Equal weights reduce to random % count.
+  const OperatorRule &pick(Difficulty difficulty, std::uint32_t random) const {
+    const Table &t = tables[(int)difficulty];
+    std::uint32_t column = random % t.count;
+    std::uint32_t coin = (random / t.count) % kCoinScale;
+    return t.rules[coin < t.threshold[column] ? column : t.alias[column]];
+  }
+
+  int operatorCount(Difficulty difficulty) const;
+  const OperatorRule &rule(Difficulty difficulty, int index) const;
+
+private:
+  static const std::uint32_t kCoinScale = 1 << 16;
+
+  struct Table {
+    int count = 0;
+    OperatorRule rules[kMaxOperators];
+    // Keep the column when coin < threshold (out of kCoinScale), otherwise
+    // take its alias.
+    std::uint32_t threshold[kMaxOperators] = {};
+    std::uint8_t alias[kMaxOperators] = {};
+  };
+
+  static void compile(Table &table);
+
+  Table tables[kDifficulties];
+};
+
+#endif // GENERATIONRULES_H
@@ -0,0 +1,368 @@
+#include "Grader.h"
+#include "MathGenerator.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const char *const kDifficultyNames[GenerationRules::kDifficulties] = {
+    "easy", "medium", "hard", "expert", "master"};
+static const char kOptionKeys[3] = {'L', 'U', 'R'};
+
+// Chunks handed out per thread at a time. Output for a whole window is held
+// until it can be written in order, so this bounds memory.
+static const int kChunksPerThread = 4;
+
+void GradeTotals::add(const GradeTotals &other) {
+  sessions += other.sessions;
+  malformed += other.malformed;
+  for (int d = 0; d < GenerationRules::kDifficulties; ++d) {
+    answers[d] += other.answers[d];
+    correct[d] += other.correct[d];
+  }
+  timeouts += other.timeouts;
+  answerMs += other.answerMs;
+  bytes += other.bytes;
+}
+
+// Time allowed per problem at `level`, as in the game: 20s, 17.5s, 15s...
+// down to 3s.
+static std::uint64_t timeLimitMs(int level) {
+  int ms = 20000 - (level - 1) * 2500;
+  return ms < 3000 ? 3000 : (std::uint64_t)ms;
+}
+
+static bool isBlank(char c) { return c == ' ' || c == '\t'; }
+
+// Next whitespace-separated word of [p, end); false at the end of the line.
+static bool nextWord(const char *&p, const char *end, const char *&word,
+                     std::size_t &length) {
+  while (p < end && isBlank(*p))
+    ++p;
+  word = p;
+  while (p < end && !isBlank(*p))
+    ++p;
+  length = p - word;
+  return length > 0;
+}
+
+static bool parseUnsigned(const char *text, std::size_t length,
+                          std::uint64_t &value) {
+  if (length == 0 || length > 19)
+    return false;
+  value = 0;
+  for (std::size_t i = 0; i < length; ++i) {
+    if (text[i] < '0' || text[i] > '9')
+      return false;
+    value = value * 10 + (text[i] - '0');
+  }
+  return true;
+}
+
+static void appendError(std::string &out, const char *id, std::size_t idLength,
+                        const char *message, const char *word,
+                        std::size_t wordLength) {
+  out.append(id, idLength);
+  out += " error: ";
+  out += message;
+  out.append(" '").append(word, wordLength).append("'\n");
+}
+
+void Grader::gradeLine(const char *line, std::size_t length,
+                       MathGenerator &generator, std::string &out,
+                       GradeTotals &totals) {
+  const char *p = line, *end = line + length;
+  if (end > p && end[-1] == '\r')
+    --end;
+  const char *id, *word;
+  std::size_t idLength, wordLength;
+  if (!nextWord(p, end, id, idLength) || id[0] == '#')
+    return;
+
+  std::uint64_t seed = 0;
+  if (!nextWord(p, end, word, wordLength) ||
+      !parseUnsigned(word, wordLength, seed)) {
+    appendError(out, id, idLength, "bad seed", word, wordLength);
+    totals.malformed++;
+    return;
+  }
+  int difficulty = -1;
+  nextWord(p, end, word, wordLength);
+  for (int d = 0; d < GenerationRules::kDifficulties; ++d)
+    if (std::strlen(kDifficultyNames[d]) == wordLength &&
+        std::memcmp(kDifficultyNames[d], word, wordLength) == 0)
+      difficulty = d;
+  if (difficulty < 0) {
+    appendError(out, id, idLength, "bad difficulty", word, wordLength);
+    totals.malformed++;
+    return;
+  }
+
+  generator.setSeed(seed);
+  generator.setDifficulty((Difficulty)difficulty);
+  int previousResult = 0;
+  std::uint64_t score = 0, answers = 0, correct = 0, wrong = 0, timeouts = 0,
+                totalMs = 0;
+  for (std::uint64_t i = 0; nextWord(p, end, word, wordLength); ++i) {
+    int option = -1;
+    for (int o = 0; o < 3; ++o)
+      if (word[0] == kOptionKeys[o])
+        option = o;
+    std::uint64_t ms = 0;
+    if (wordLength < 3 || word[1] != ':' || (option < 0 && word[0] != '-') ||
+        !parseUnsigned(word + 2, wordLength - 2, ms)) {
+      appendError(out, id, idLength, "bad answer", word, wordLength);
+      totals.malformed++;
+      return;
+    }
+
+    int level = 1 + (int)(i / MathGenerator::kChainLength);
+    MathProblem problem = generator.problemAfter(level, i, previousResult);
+    previousResult = problem.correctAnswer;
+    answers++;
+    totalMs += ms;
+    if (option < 0 || ms > timeLimitMs(level)) {
+      timeouts++;
+    } else if (problem.options[option] == problem.correctAnswer) {
+      correct++;
+      score += 10 * (std::uint64_t)level;
+    } else {
+      wrong++;
+    }
+  }
+
+  char buffer[96];
+  int n = std::snprintf(buffer, sizeof(buffer), " %llu %llu %llu %llu %llu\n",
+                        (unsigned long long)correct, (unsigned long long)wrong,
+                        (unsigned long long)timeouts,
+                        (unsigned long long)score,
+                        (unsigned long long)(answers ? totalMs / answers : 0));
+  out.append(id, idLength).append(buffer, n);
+  totals.sessions++;
+  totals.answers[difficulty] += answers;
+  totals.correct[difficulty] += correct;
+  totals.timeouts += timeouts;
+  totals.answerMs += totalMs;
+}
+
+Grader::Grader(const GenerationRules &rules, int threads)
+    : rules(rules), threads(threads), chunkBytes(kDefaultChunkBytes) {
+  if (this->threads <= 0)
+    this->threads = (int)std::thread::hardware_concurrency();
+  if (this->threads <= 0)
+    this->threads = 1;
+  if (this->threads > maxThreads())
+    this->threads = maxThreads();
+}
+
+int Grader::maxThreads() {
+  int cores = (int)std::thread::hardware_concurrency();
+  return kMaxThreadsPerCore * (cores > 0 ? cores : 1);
+}
+
+void Grader::setChunkBytes(std::size_t bytes) {
+  chunkBytes = bytes > 0 ? bytes : 1;
+}
+
+namespace {
+
+// Chunks of the current window a worker still has to grade, as [front, back)
+// packed into one word: the owner takes from the front and thieves from the
+// back, both with a compare-and-swap.
+struct alignas(64) ChunkQueue {
+  std::atomic<std::uint64_t> range{0};
+
+  void reset(std::uint32_t front, std::uint32_t back) {
+    range.store((std::uint64_t)front << 32 | back, std::memory_order_relaxed);
+  }
+
+  bool take(bool fromFront, std::uint32_t &chunk) {
+    std::uint64_t value = range.load(std::memory_order_relaxed);
+    for (;;) {
+      std::uint32_t front = (std::uint32_t)(value >> 32);
+      std::uint32_t back = (std::uint32_t)value;
+      if (front >= back)
+        return false;
+      std::uint64_t next = fromFront
+                               ? (std::uint64_t)(front + 1) << 32 | back
+                               : (std::uint64_t)front << 32 | (back - 1);
+      if (range.compare_exchange_weak(value, next, std::memory_order_relaxed)) {
+        chunk = fromFront ? front : back - 1;
+        return true;
+      }
+    }
+  }
+};
+
+struct Worker {
+  MathGenerator generator;
+  GradeTotals totals;
+};
+
+// Offset of the first line that starts at or after `offset`.
+std::size_t lineStart(const char *data, std::size_t size, std::size_t offset) {
+  if (offset == 0 || offset >= size)
+    return offset < size ? 0 : size;
+  const void *newline = std::memchr(data + offset - 1, '\n', size - offset + 1);
+  return newline ? (const char *)newline - data + 1 : size;
+}
+
+} // namespace
+
+bool Grader::gradeFile(const std::string &path, std::FILE *out,
+                       std::string &error) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat info;
+  if (fd < 0 || fstat(fd, &info) != 0) {
+    if (fd >= 0)
+      close(fd);
+    error = "cannot read " + path;
+    return false;
+  }
+  std::size_t size = (std::size_t)info.st_size;
+  if (size == 0) {
+    close(fd);
+    return true;
+  }
+  void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    error = "cannot map " + path;
+    return false;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const char *data = (const char *)map;
+
+  // A chunk grades the lines that start inside it, so workers find their own
+  // boundaries and no line is split.
+  auto gradeChunk = [&](std::size_t chunk, Worker &worker, std::string &text) {
+    std::size_t begin = lineStart(data, size, chunk * chunkBytes);
+    std::size_t end = lineStart(data, size, (chunk + 1) * chunkBytes);
+    for (std::size_t p = begin; p < end;) {
+      const void *newline = std::memchr(data + p, '\n', end - p);
+      std::size_t lineEnd = newline ? (const char *)newline - data : end;
+      gradeLine(data + p, lineEnd - p, worker.generator, text, worker.totals);
+      p = lineEnd + 1;
+    }
+    worker.totals.bytes += end - begin;
+  };
+
+  std::size_t chunks = (size + chunkBytes - 1) / chunkBytes;
+  std::size_t window = (std::size_t)threads * kChunksPerThread;
+  std::vector<std::string> output(window);
+  std::unique_ptr<ChunkQueue[]> queues(new ChunkQueue[threads]);
+  std::vector<Worker> workers(threads);
+  for (Worker &worker : workers)
+    worker.generator.setRules(rules);
+
+  std::mutex mutex;
+  std::condition_variable started, finished;
+  std::uint64_t generation = 0;
+  std::size_t windowFirst = 0;
+  int busy = 0;
+  bool done = false;
+
+  auto work = [&](int self) {
+    std::uint64_t seen = 0;
+    for (;;) {
+      std::size_t first;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        started.wait(lock, [&] { return done || generation != seen; });
+        if (done)
+          return;
+        seen = generation;
+        first = windowFirst;
+      }
+      std::uint32_t chunk;
+      for (;;) {
+        bool found = queues[self].take(true, chunk);
+        for (int k = 1; !found && k < threads; ++k)
+          found = queues[(self + k) % threads].take(false, chunk);
+        if (!found)
+          break;
+        output[chunk].clear();
+        gradeChunk(first + chunk, workers[self], output[chunk]);
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--busy == 0)
+        finished.notify_one();
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; ++t)
+    pool.emplace_back(work, t);
+
+  long page = sysconf(_SC_PAGESIZE);
+  for (std::size_t first = 0; first < chunks; first += window) {
+    std::size_t count = std::min(window, chunks - first);
+    for (int t = 0; t < threads; ++t)
+      queues[t].reset((std::uint32_t)(count * t / threads),
+                      (std::uint32_t)(count * (t + 1) / threads));
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      windowFirst = first;
+      busy = threads;
+      generation++;
+      started.notify_all();
+      finished.wait(lock, [&] { return busy == 0; });
+    }
+    for (std::size_t i = 0; i < count; ++i)
+      std::fwrite(output[i].data(), 1, output[i].size(), out);
+
+    // Graded pages are not needed again; drop them so resident memory stays
+    // flat however large the log is.
+    std::size_t graded = (first + count) * chunkBytes;
+    graded = std::min(graded, size) / page * page;
+    if (graded > 0)
+      madvise(map, graded, MADV_DONTNEED);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    started.notify_all();
+  }
+  for (std::thread &thread : pool)
+    thread.join();
+  munmap(map, size);
+  for (const Worker &worker : workers)
+    total.add(worker.totals);
+  return true;
+}
+
+void Grader::printSummary(std::FILE *out, double seconds) const {
+  std::uint64_t answers = 0, correct = 0;
+  std::fprintf(out, "%-8s %10s %10s %9s\n", "level", "answers", "correct",
+               "accuracy");
+  for (int d = 0; d < GenerationRules::kDifficulties; ++d) {
+    answers += total.answers[d];
+    correct += total.correct[d];
+    if (total.answers[d] == 0)
+      continue;
+    std::fprintf(out, "%-8s %10llu %10llu %8.1f%%\n", kDifficultyNames[d],
+                 (unsigned long long)total.answers[d],
+                 (unsigned long long)total.correct[d],
+                 100.0 * total.correct[d] / total.answers[d]);
+  }
+  std::fprintf(out, "%-8s %10llu %10llu %8.1f%%\n", "all",
+               (unsigned long long)answers, (unsigned long long)correct,
+               answers ? 100.0 * correct / answers : 0.0);
+  std::fprintf(out, "%llu sessions, %llu malformed, %llu timeouts, mean answer "
+                    "%.0f ms\n",
+               (unsigned long long)total.sessions,
+               (unsigned long long)total.malformed,
+               (unsigned long long)total.timeouts,
+               answers ? (double)total.answerMs / answers : 0.0);
+  double mb = total.bytes / 1e6;
+  std::fprintf(out, "%.1f MB in %.2f s (%.0f MB/s, %d threads)\n", mb, seconds,
+               seconds > 0.0 ? mb / seconds : 0.0, threads);
+}
@@ -0,0 +1,73 @@
+#ifndef GRADER_H
+#define GRADER_H
+
+#include "GenerationRules.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+class MathGenerator;
+
+// Totals over everything graded so far.
+struct GradeTotals {
+  std::uint64_t sessions = 0;
+  std::uint64_t malformed = 0; // Lines that could not be graded
+  std::uint64_t answers[GenerationRules::kDifficulties] = {};
+  std::uint64_t correct[GenerationRules::kDifficulties] = {};
+  std::uint64_t timeouts = 0;
+  std::uint64_t answerMs = 0; // Summed time of the answers given
+  std::uint64_t bytes = 0;
+
+  void add(const GradeTotals &other);
+};
+
+// Grades offline answer logs against the seeded generator. A log has one
+// session per line:
+//
+//   <session> <seed> <difficulty> <answer> <answer> ...
+//
+// where difficulty is easy, medium, hard, expert or master and each answer is
+// <option>:<ms>, option being L, U or R (the lane picked) or - for none.
+// Problem i of a session is problemAt(1 + i / 10, i) for its seed, as in a
+// seeded game; an answer counts if it is right and within that level's time
+// limit. Unlike a game, a sheet does not end at the first miss: every answer
+// on the line is scored, so a wrong answer or timeout only costs its own
+// points. Lines starting with # are comments.
+//
+// The log is memory-mapped and cut into chunks at line boundaries. Worker
+// threads grade a window of chunks at a time, stealing chunks from each other
+// when their own run out, and each finished window is written in input order.
+// Memory use depends on the chunk size and thread count, not the log size.
+class Grader {
+public:
+  static const std::size_t kDefaultChunkBytes = 1 << 20;
+  // More workers than this per core only adds stacks and stealing.
+  static const int kMaxThreadsPerCore = 4;
+
+  // `threads` <= 0 uses every core; counts above maxThreads() are capped.
+  explicit Grader(const GenerationRules &rules, int threads = 0);
+  static int maxThreads();
+
+  void setChunkBytes(std::size_t bytes);
+
+  // Writes one line per session to `out`:
+  //   <session> <correct> <wrong> <timeouts> <score> <mean ms>
+  // or "<session> error: ..." for lines that cannot be graded.
+  bool gradeFile(const std::string &path, std::FILE *out, std::string &error);
+
+  const GradeTotals &totals() const { return total; }
+  void printSummary(std::FILE *out, double seconds) const;
+
+  // Grades one log line (without its newline) into `out`.
+  static void gradeLine(const char *line, std::size_t length,
+                        MathGenerator &generator, std::string &out,
+                        GradeTotals &totals);
+
+private:
+  GenerationRules rules;
+  int threads;
+  std::size_t chunkBytes;
+  GradeTotals total;
+};
+
+#endif // GRADER_H
@@ -0,0 +1,216 @@
+#include "Kiosk.h"
+
+// The event loop is built on epoll, timerfd and signalfd.
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+// Same rate as Game's logic thread; Game::update() is expressed per tick.
+static const long kTickNs = 16667000;
+// After a stall, ticks are caught up to this many at once; the rest are lost
+// rather than fast-forwarding everyone's timer.
+static const std::uint64_t kMaxCatchUpTicks = 4;
+static const std::uint64_t kSignalEvent = UINT64_MAX;
+static const std::uint64_t kTimerEvent = UINT64_MAX - 1;
+
+Kiosk::Kiosk()
+    : epollFd(epoll_create1(EPOLL_CLOEXEC)),
+      timerFd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+      ticking(false) {}
+
+Kiosk::~Kiosk() {
+  for (auto &seat : seatList)
+    closeSeat(*seat);
+  if (timerFd >= 0)
+    close(timerFd);
+  if (epollFd >= 0)
+    close(epollFd);
+}
+
+Game *Kiosk::addSeat(const std::string &device, const std::string &type,
+                     std::string &error) {
+  std::unique_ptr<Seat> seat(new Seat);
+  seat->device = device;
+  seat->fd = open(device.c_str(), O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if (seat->fd < 0 || !isatty(seat->fd)) {
+    if (seat->fd >= 0)
+      close(seat->fd);
+    error = device + ": not a terminal";
+    return nullptr;
+  }
+  seat->in = fdopen(seat->fd, "r");
+  seat->out = fdopen(dup(seat->fd), "w");
+  if (seat->in != nullptr && seat->out != nullptr)
+    seat->game.reset(new Game(type.c_str(), seat->out, seat->in, device));
+  if (!seat->game || !seat->game->hasTerminal()) {
+    closeSeat(*seat);
+    error = device + ": cannot start terminal type " + type;
+    return nullptr;
+  }
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = seatList.size();
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, seat->fd, &event) != 0) {
+    closeSeat(*seat);
+    error = device + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  seatList.push_back(std::move(seat));
+  return seatList.back()->game.get();
+}
+
+std::size_t Kiosk::seats() const { return seatList.size(); }
+
+void Kiosk::closeSeat(Seat &seat) {
+  if (!seat.open)
+    return;
+  seat.open = false;
+  if (seat.fd >= 0)
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, seat.fd, nullptr);
+  seat.game.reset(); // Restores the terminal while its files are still open
+  if (seat.out != nullptr)
+    std::fclose(seat.out);
+  if (seat.in != nullptr)
+    std::fclose(seat.in);
+  else if (seat.fd >= 0)
+    close(seat.fd);
+}
+
+// Ticks only run while some seat needs them, so idle menus cost no wakeups.
+bool Kiosk::updateTimer() {
+  bool needed = false;
+  for (const auto &seat : seatList)
+    if (seat->open && seat->game->needsTicks())
+      needed = true;
+  if (needed == ticking)
+    return true;
+  itimerspec spec{};
+  if (needed) {
+    spec.it_interval.tv_nsec = kTickNs;
+    spec.it_value.tv_nsec = kTickNs;
+  }
+  ticking = needed;
+  return timerfd_settime(timerFd, 0, &spec, nullptr) == 0;
+}
+
+bool Kiosk::run(std::string &error) {
+  if (epollFd < 0 || timerFd < 0) {
+    error = "kiosk: cannot create the event loop";
+    return false;
+  }
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, nullptr);
+  int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u64 = kSignalEvent;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+  event.data.u64 = kTimerEvent;
+  epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &event);
+
+  for (auto &seat : seatList)
+    seat->game->start();
+  updateTimer();
+
+  bool running = !seatList.empty();
+  epoll_event events[32];
+  while (running) {
+    int n = epoll_wait(epollFd, events, 32, -1);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      error = std::string("kiosk: ") + std::strerror(errno);
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      std::uint64_t tag = events[i].data.u64;
+      if (tag == kSignalEvent) {
+        signalfd_siginfo info; // Consume it, or unblocking would deliver it
+        if (read(signalFd, &info, sizeof(info)) == sizeof(info))
+          running = false;
+      } else if (tag == kTimerEvent) {
+        std::uint64_t expirations = 0;
+        if (read(timerFd, &expirations, sizeof(expirations)) !=
+            sizeof(expirations))
+          continue;
+        std::uint64_t ticks = std::min(expirations, kMaxCatchUpTicks);
+        for (auto &seat : seatList)
+          for (std::uint64_t t = 0; seat->open && t < ticks; ++t)
+            seat->game->tick();
+      } else {
+        Seat &seat = *seatList[tag];
+        if (!seat.open)
+          continue;
+        if (events[i].events & EPOLLIN)
+          seat.game->pollInput();
+        if (events[i].events & (EPOLLHUP | EPOLLERR))
+          closeSeat(seat);
+      }
+    }
+    updateTimer();
+    running = running && std::any_of(seatList.begin(), seatList.end(),
+                                     [](const std::unique_ptr<Seat> &seat) {
+                                       return seat->open;
+                                     });
+  }
+
+  if (signalFd >= 0)
+    close(signalFd);
+  sigprocmask(SIG_UNBLOCK, &signals, nullptr);
+  return error.empty();
+}
+
+void Kiosk::printUsage(std::FILE *out) const {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  double seats = seatList.empty() ? 1.0 : (double)seatList.size();
+  std::fprintf(out,
+               "%zu seats: peak RSS %ld KB (%.0f KB per seat), CPU %.2f s "
+               "(%.3f s per seat)\n",
+               seatList.size(), usage.ru_maxrss, usage.ru_maxrss / seats, cpu,
+               cpu / seats);
+}
+
+#else
+
+Kiosk::Kiosk() : epollFd(-1), timerFd(-1), ticking(false) {}
+
+Kiosk::~Kiosk() {}
+
+Game *Kiosk::addSeat(const std::string &, const std::string &,
+                     std::string &error) {
+  error = "kiosk mode needs Linux";
+  return nullptr;
+}
+
+std::size_t Kiosk::seats() const { return 0; }
+
+void Kiosk::closeSeat(Seat &) {}
+
+bool Kiosk::updateTimer() { return false; }
+
+bool Kiosk::run(std::string &error) {
+  error = "kiosk mode needs Linux";
+  return false;
+}
+
+void Kiosk::printUsage(std::FILE *) const {}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef KIOSK_H
+#define KIOSK_H
+
+#include "Game.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs one Game per terminal in a single process, for lab machines that drive
+// many physical terminals or ptys. Seats share the code, the translations and
+// the sprites; each has its own ncurses SCREEN, game state and input fd. One
+// epoll loop serves them all: keys from any terminal, and a 60 Hz tick while
+// some seat is playing or animating.
+class Kiosk {
+public:
+  Kiosk();
+  ~Kiosk();
+  Kiosk(const Kiosk &) = delete;
+  Kiosk &operator=(const Kiosk &) = delete;
+
+  // Opens `device` (e.g. /dev/ttyS0 or /dev/pts/3), a terminal of terminfo
+  // `type`, as a new seat. Returns its game for configuration, or nullptr.
+  Game *addSeat(const std::string &device, const std::string &type,
+                std::string &error);
+  std::size_t seats() const;
+
+  // Serves the seats until SIGINT or SIGTERM, or until every terminal has
+  // hung up.
+  bool run(std::string &error);
+
+  // Peak memory and CPU time of the process, in total and per seat.
+  void printUsage(std::FILE *out) const;
+
+private:
+  struct Seat {
+    std::string device;
+    int fd = -1;
+    std::FILE *in = nullptr;
+    std::FILE *out = nullptr;
+    std::unique_ptr<Game> game;
+    bool open = true;
+  };
+
+  void closeSeat(Seat &seat);
+  bool updateTimer();
+
+  std::vector<std::unique_ptr<Seat>> seatList;
+  int epollFd;
+  int timerFd;
+  bool ticking;
+};
+
+#endif // KIOSK_H
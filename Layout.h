@@ -0,0 +1,66 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+// Precomputed screen coordinates. UI fills these in once per terminal size and
+// language (see UI::updateLayout) so the draw code never has to query the
+// terminal or re-measure labels on every frame.
+
+struct MainMenuLayout {
+  int titleY, titleX;
+  int optionY[3];
+  int optionX[3];
+};
+
+struct SettingsLayout {
+  int titleY, titleX;
+  int rowY[3]; // Difficulty, Language, Back
+  int backX;
+};
+
+struct GameLayout {
+  int startX;    // Left edge of the (at most 80 column) play area
+  int gameWidth; // Width of the play area
+  int hudY;
+  int scoreX;
+  int levelRightX; // Level label is right-aligned against this column
+  int challengeCenterX;
+  int barY, barX, barWidth, barEndX;
+  int problemY, problemCenterX;
+  int optionsY;
+  int laneX[3]; // Left, Up (Middle), Right
+  int arrowY;
+};
+
+struct GameOverLayout {
+  int titleY, titleX;
+  int scoreY, levelY;
+  int promptY, promptX;
+  int spriteX, spriteY;
+};
+
+struct LevelCompleteLayout {
+  int titleY;
+  int promptY, promptX;
+  int catY;
+};
+
+struct ScoreboardLayout {
+  int titleY, titleX;
+  int headerY;
+  int firstRowY, maxRows;
+  int tableX; // Left edge of the table, centred as a whole
+  int promptY, promptX;
+};
+
+struct ScreenLayout {
+  int width = 0;
+  int height = 0;
+  MainMenuLayout mainMenu;
+  SettingsLayout settings;
+  GameLayout game;
+  GameOverLayout gameOver;
+  LevelCompleteLayout levelComplete;
+  ScoreboardLayout scoreboard;
+};
+
+#endif // LAYOUT_H
@@ -1,205 +1,330 @@
 #include "MathGenerator.h"
+#include "AllocTracker.h"
+#include "Metrics.h"
+#include "ProblemClassifier.h"
+#include "ProblemFilter.h"
+#include "ReviewScheduler.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
 #include <string>
 #include <vector>
 
-MathGenerator::MathGenerator() {
+// SplitMix64 finalizer; a good enough bijective mixer for keying streams.
+static std::uint64_t mix64(std::uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+static std::uint64_t gcd64(std::uint64_t a, std::uint64_t b) {
+  while (b != 0) {
+    std::uint64_t t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+MathGenerator::MathGenerator()
+    : seeded(false), seed(0), levelKey(0), streamKey(0), streamCounter(0),
+      streamIndex(0), useBand(false), bandMin(0), bandMax(0),
+      reviews(nullptr), reviewRate(0.0f), sessionFilter(nullptr) {
   std::srand(std::time(nullptr));
   currentDifficulty = Difficulty::EASY;
+  usedOperands.reserve(kChainLength); // At most one per problem of a level
 }
 
 void MathGenerator::setDifficulty(Difficulty diff) { currentDifficulty = diff; }
 
 void MathGenerator::startNewLevel() { usedOperands.clear(); }
 
+void MathGenerator::setSeed(std::uint64_t newSeed) {
+  seeded = true;
+  seed = newSeed;
+  beginStream(1, 0);
+}
+
+void MathGenerator::clearSeed() { seeded = false; }
+
+bool MathGenerator::isSeeded() const { return seeded; }
+
+void MathGenerator::beginStream(int level, std::uint64_t index) {
+  levelKey = mix64(seed ^ mix64((std::uint64_t)level));
+  streamKey = mix64(levelKey ^ mix64(index));
+  streamCounter = 0;
+  streamIndex = index;
+}
+
+int MathGenerator::nextRandom() {
+  if (!seeded)
+    return std::rand();
+  // Counter-based: draw n of a problem is a pure function of its key and n.
+  std::uint64_t x = mix64(streamKey + streamCounter++ * 0xD1B54A32D192ED03ULL);
+  return (int)(x >> 33);
+}
+
 int MathGenerator::generateRandomNumber(int min, int max) {
-  return min + (std::rand() % (max - min + 1));
+  // 64-bit span: a full int range would wrap to zero in 32 bits.
+  long long span = (long long)max - min + 1;
+  return (int)(min + nextRandom() % span);
+}
+
+int MathGenerator::permutedOperand(int min, int max) {
+  // Keyed affine permutation of [min, max]: consecutive indices within a level
+  // map to distinct operands without remembering which were already used.
+  std::uint64_t n = (std::uint64_t)((long long)max - min + 1);
+  std::uint64_t mult = (mix64(levelKey ^ 0x5851F42D4C957F2DULL) % n) | 1;
+  while (gcd64(mult, n) != 1)
+    mult += 2;
+  std::uint64_t offset = mix64(levelKey) % n;
+  return min + (int)((mult * (streamIndex % n) + offset) % n);
+}
+
+MathProblem MathGenerator::problemAt(int level, std::uint64_t index) {
+  AllocScope allocScope(Subsystem::GENERATOR);
+  std::uint64_t first = index - index % kChainLength;
+  int previousResult = 0;
+  MathProblem problem;
+  for (std::uint64_t i = first; i <= index; ++i) {
+    problem = problemAfter(level, i, previousResult);
+    previousResult = problem.correctAnswer;
+  }
+  return problem;
+}
+
+MathProblem MathGenerator::problemAfter(int level, std::uint64_t index,
+                                        int previousResult) {
+  int position = (int)(index % kChainLength);
+  beginStream(level, index);
+  return generateProblem(position == 0 ? 0 : previousResult, position);
+}
+
+void MathGenerator::setDifficultyBand(int minScore, int maxScore) {
+  useBand = true;
+  bandMin = minScore;
+  bandMax = maxScore;
+}
+
+void MathGenerator::clearDifficultyBand() { useBand = false; }
+
+void MathGenerator::setReviewScheduler(ReviewScheduler *scheduler,
+                                       float rate) {
+  reviews = scheduler;
+  reviewRate = rate;
+}
+
+void MathGenerator::setSessionFilter(ProblemFilter *filter) {
+  sessionFilter = filter;
+}
+
+void MathGenerator::setRules(const GenerationRules &newRules) {
+  rules = newRules;
+}
+
+const GenerationRules &MathGenerator::getRules() const { return rules; }
+
+MathProblem MathGenerator::problemFromFact(char op, int a, int b) {
+  MathProblem problem;
+  problem.op = op;
+  problem.operandA = a;
+  problem.operandB = b;
+  switch (op) {
+  case 's': {
+    int base = 0;
+    while ((base + 1) * (base + 1) <= a)
+      base++;
+    problem.question = "sqrt(" + std::to_string(a) + ")";
+    problem.correctAnswer = base;
+    break;
+  }
+  case 'c': {
+    int base = 0;
+    while ((base + 1) * (base + 1) * (base + 1) <= a)
+      base++;
+    problem.question = "cbrt(" + std::to_string(a) + ")";
+    problem.correctAnswer = base;
+    break;
+  }
+  default:
+    problem.question =
+        std::to_string(a) + " " + op + " " + std::to_string(b);
+    if (op == '+')
+      problem.correctAnswer = a + b;
+    else if (op == '-')
+      problem.correctAnswer = a - b;
+    else if (op == '*')
+      problem.correctAnswer = a * b;
+    else
+      problem.correctAnswer = b != 0 ? a / b : 0;
+    break;
+  }
+  fillOptions(problem);
+  return problem;
 }
 
 MathProblem MathGenerator::generateProblem(int previousResult,
                                            int challengesPassed) {
+  AllocScope allocScope(Subsystem::GENERATOR);
+  if (reviews && !seeded && reviewRate > 0.0f &&
+      nextRandom() % 1000 < (int)(reviewRate * 1000.0f)) {
+    Fact fact;
+    if (reviews->takeDue(ReviewScheduler::nowMs(), fact))
+      return problemFromFact(fact.op, fact.a, fact.b);
+  }
+
+  ProblemFilter *filter = seeded ? nullptr : sessionFilter;
+  if (!useBand && filter == nullptr)
+    return generateCandidate(previousResult, challengesPassed);
+
+  // Penalty ranks candidates: a repeat is worse than any band miss.
+  const int kRepeatPenalty = 1000;
+  MathProblem best;
+  int bestPenalty = -1;
+  for (int attempt = 0; attempt < kMaxRetries; ++attempt) {
+    size_t usedBefore = usedOperands.size();
+    MathProblem candidate = generateCandidate(previousResult, challengesPassed);
+    int penalty = 0;
+    if (useBand) {
+      int score = ProblemClassifier::score(candidate);
+      if (score < bandMin)
+        penalty = bandMin - score;
+      else if (score > bandMax)
+        penalty = score - bandMax;
+    }
+    if (filter != nullptr &&
+        filter->contains(candidate.op, candidate.operandA, candidate.operandB))
+      penalty += kRepeatPenalty;
+    if (penalty == 0) {
+      if (filter != nullptr)
+        filter->insert(candidate.op, candidate.operandA, candidate.operandB);
+      Metrics::generatorRetries(attempt);
+      return candidate;
+    }
+    // A rejected candidate must not use up its operand for the level.
+    usedOperands.resize(usedBefore);
+    if (bestPenalty < 0 || penalty < bestPenalty) {
+      best = candidate;
+      bestPenalty = penalty;
+    }
+  }
+  if (best.op == '+' || best.op == '-')
+    usedOperands.push_back(best.operandB);
+  if (filter != nullptr)
+    filter->insert(best.op, best.operandA, best.operandB);
+  Metrics::generatorRetries(kMaxRetries);
+  return best;
+}
+
+// Largest result a chained rule can reach from `previousResult`; the rules
+// file bounds everything else.
+static bool chainFits(const OperatorRule &rule, int previousResult) {
+  long long a = std::llabs(previousResult);
+  long long b = std::max(std::llabs(rule.bMin), std::llabs(rule.bMax));
+  if (rule.op == '/')
+    b = rule.fallback ? std::max(std::llabs(rule.fallbackMin),
+                                 std::llabs(rule.fallbackMax))
+                      : 0;
+  long long worst = rule.op == '*' ? a * b : a + b;
+  return worst <= INT_MAX;
+}
+
+MathProblem MathGenerator::generateCandidate(int previousResult,
+                                             int challengesPassed) {
   (void)challengesPassed; // Suppress unused warning if not used in this path
                           // (e.g. for +/- logic which is now strict)
   MathProblem problem;
-  int a, b;
-  char op = '+';
+  const OperatorRule &rule = rules.pick(currentDifficulty, nextRandom());
+  char op = rule.op;
+  int a = 0, b = 0;
   int result = 0;
 
-  // Determine operation based on difficulty
-  std::vector<char> allowedOps;
-  allowedOps.push_back('+');
-  if (currentDifficulty >= Difficulty::MEDIUM)
-    allowedOps.push_back('-');
-  if (currentDifficulty >= Difficulty::HARD)
-    allowedOps.push_back('*');
-  if (currentDifficulty >= Difficulty::EXPERT)
-    allowedOps.push_back('/');
-  // Master adds sqrt/cbrt logic, handled separately or as special ops
-
-  // Simple logic: if previousResult is 0 (start), generate fresh.
-  // If not, use previousResult as one operand to chain?
-  // The prompt says: "The following math problems are generated using the
-  // result of the previous math problem."
-
-  bool usePrevious = (previousResult != 0); // Simplified check
-
-  if (currentDifficulty == Difficulty::MASTER && (std::rand() % 5 == 0)) {
-    // 20% chance for sqrt/cbrt in Master
-    if (std::rand() % 2 == 0) {
-      // Sqrt
-      int base = generateRandomNumber(2, 20);
-      int square = base * base;
-      if (usePrevious && previousResult > 0 && previousResult < 1000) {
-        // Try to use previous result if it's a perfect square? Hard to
-        // guarantee. Let's just make a new problem for roots to keep flow
-        // smooth or adapt previous if lucky. To strictly follow "using result
-        // of previous", we might do: previous + X = perfect square? Let's stick
-        // to simple chaining: New number op Previous Result.
-      }
-      problem.question = "sqrt(" + std::to_string(square) + ")";
-      result = base;
+  // Problems are generated using the result of the previous problem, where
+  // the rule allows it and no b in range can overflow the result.
+  bool chained = rule.chain && previousResult != 0 &&
+                 previousResult >= rule.chainMin &&
+                 chainFits(rule, previousResult);
+
+  switch (op) {
+  case 's': {
+    int root = generateRandomNumber(rule.aMin, rule.aMax);
+    a = root * root;
+    result = root;
+    problem.question = "sqrt(" + std::to_string(a) + ")";
+    break;
+  }
+  case 'c': {
+    int root = generateRandomNumber(rule.aMin, rule.aMax);
+    a = root * root * root;
+    result = root;
+    problem.question = "cbrt(" + std::to_string(a) + ")";
+    break;
+  }
+  case '/':
+    b = generateRandomNumber(rule.bMin, rule.bMax);
+    if (chained && previousResult % b == 0) {
+      a = previousResult;
+      result = a / b;
+    } else if (chained && rule.fallback) {
+      // The previous result is shown to the player and cannot be adjusted to
+      // divide evenly, so ask an addition or subtraction with it instead.
+      a = previousResult;
+      op = (nextRandom() % 2 == 0) ? '+' : '-';
+      b = generateRandomNumber(rule.fallbackMin, rule.fallbackMax);
+      result = op == '+' ? a + b : a - b;
     } else {
-      // Cbrt
-      int base = generateRandomNumber(2, 10);
-      int cube = base * base * base;
-      problem.question = "cbrt(" + std::to_string(cube) + ")";
-      result = base;
+      result = generateRandomNumber(rule.aMin, rule.aMax); // The answer
+      a = result * b;                                     // The dividend
     }
-  } else {
-    // Standard arithmetic
-    op = allowedOps[std::rand() % allowedOps.size()];
-
-    if (op == '+' || op == '-') {
-      // Enforce double digits (>= 10) for + and -
-      int maxVal = 10 * ((int)currentDifficulty + 1);
-      if (maxVal < 20)
-        maxVal = 20;
-
-      if (usePrevious) {
-        a = previousResult;
-        // If previous result is single digit, we can't easily fix 'a' without
-        // breaking the chain rule. But user said "never operate on single digit
-        // numbers". If 'a' is < 10, maybe we just don't use it? Or we add to it
-        // to make it >= 10? Let's just not use previous if it's small for +/-?
-        // Or we accept 'a' as is (since it's the result of previous) and only
-        // enforce 'b'? "never operate on single digit numbers" implies both
-        // operands. If previous result is 5, and we need 5 + X, 5 is single
-        // digit. So we must NOT use previous result if it is < 10 for +/-.
-        if (a < 10) {
-          usePrevious = false;
-          a = generateRandomNumber(10, 99); // Force double digit
-        }
-      } else {
-        a = generateRandomNumber(10, 99);
-      }
-
-      // Adjust maxVal if needed based on difficulty, but keeping it simple:
-      // double digits. Actually, let's respect difficulty somewhat but ensure
-      // min is 10. Easy: 10-20? Medium: 10-50? Let's use the calculated maxVal
-      // but ensure min is 10.
-      if (maxVal < 30)
-        maxVal = 30; // Give some range
-
-      // Generate unique b
-      int attempts = 0;
-      do {
-        b = generateRandomNumber(10, maxVal);
-        attempts++;
-
-        // Check if b is in usedOperands
-        bool used = false;
-        for (int val : usedOperands) {
-          if (val == b) {
-            used = true;
-            break;
-          }
-        }
+    break;
+  default: // + - *
+    a = chained ? previousResult : generateRandomNumber(rule.aMin, rule.aMax);
+    b = rule.uniqueB ? uniqueOperand(rule.bMin, rule.bMax)
+                     : generateRandomNumber(rule.bMin, rule.bMax);
+    result = op == '+' ? a + b : op == '-' ? a - b : a * b;
+    break;
+  }
 
-        if (!used) {
-          usedOperands.push_back(b);
-          break;
-        }
+  if (op != 's' && op != 'c') {
+    char buffer[48];
+    std::snprintf(buffer, sizeof(buffer), "%d %c %d", a, op, b);
+    problem.question = buffer;
+  }
+  problem.op = op;
+  problem.operandA = a;
+  problem.operandB = b;
+  problem.correctAnswer = result;
+  fillOptions(problem);
+  return problem;
+}
 
-        // Safety break to prevent infinite loop if range is too small
-        if (attempts > 50) {
-          // Just use it if we can't find a unique one
-          break;
-        }
-      } while (true);
+int MathGenerator::uniqueOperand(int min, int max) {
+  // No history in seeded mode: a keyed permutation keeps the operand unique
+  // within the level.
+  if (seeded)
+    return permutedOperand(min, max);
 
-    } else {
-      // *, /, sqrt, cbrt allow single digits
-      if (usePrevious) {
-        a = previousResult;
-        b = generateRandomNumber(2, 12);
-      } else {
-        a = generateRandomNumber(1, 20); // Can be single
-        b = generateRandomNumber(2, 12);
-      }
-    }
-    switch (op) {
-    case '+':
-      result = a + b;
-      problem.question = std::to_string(a) + " + " + std::to_string(b);
-      break;
-    case '-':
-      // Ensure positive results for simplicity? Or allow negative. Let's allow
-      // negative.
-      result = a - b;
-      problem.question = std::to_string(a) + " - " + std::to_string(b);
-      break;
-    case '*':
-      // Keep numbers smaller for multiplication
-      if (!usePrevious)
-        a = generateRandomNumber(2, 12);
-      b = generateRandomNumber(2, 12);
-      result = a * b;
-      problem.question = std::to_string(a) + " * " + std::to_string(b);
-      break;
-    case '/':
-      // Ensure divisibility
-      b = generateRandomNumber(2, 10);
-      if (usePrevious) {
-        // We must use 'a' (previous). To make it divisible, we might need to
-        // adjust or cheat. Or we just add to 'a' to make it divisible.
-        int remainder = a % b;
-        if (remainder != 0) {
-          a += (b - remainder); // Adjust a to be divisible
-          // But we can't change previous result displayed to user...
-          // Actually, the prompt says "generated using the result".
-          // Maybe: (PreviousResult * X) / X ? Or just PreviousResult + X then
-          // divide? Let's simpler: If division is chosen, we generate A and B
-          // such that A / B = result. If we MUST use previous result, maybe we
-          // treat previous result as 'B' or 'A' if suitable. Let's just
-          // fallback to + or - if division is messy with previous result.
-          op = (std::rand() % 2 == 0) ? '+' : '-';
-          b = generateRandomNumber(1, 20);
-          if (op == '+') {
-            result = a + b;
-            problem.question = std::to_string(a) + " + " + std::to_string(b);
-          } else {
-            result = a - b;
-            problem.question = std::to_string(a) + " - " + std::to_string(b);
-          }
-        } else {
-          result = a / b;
-          problem.question = std::to_string(a) + " / " + std::to_string(b);
-        }
-      } else {
-        result = generateRandomNumber(2, 12); // This is the answer
-        a = result * b;                       // This is the dividend
-        problem.question = std::to_string(a) + " / " + std::to_string(b);
-      }
+  int b = 0;
+  for (int attempts = 1; attempts <= 51; ++attempts) {
+    b = generateRandomNumber(min, max);
+    if (std::find(usedOperands.begin(), usedOperands.end(), b) ==
+        usedOperands.end()) {
+      usedOperands.push_back(b);
       break;
     }
+    // If the range is used up, just repeat one
   }
+  return b;
+}
 
-  problem.correctAnswer = result;
+void MathGenerator::fillOptions(MathProblem &problem) {
+  int result = problem.correctAnswer;
 
   // Generate options (one correct, two wrong)
-  problem.options.resize(3);
-  problem.correctOptionIndex = std::rand() % 3;
+  problem.correctOptionIndex = nextRandom() % 3;
   problem.options[problem.correctOptionIndex] = result;
 
   for (int i = 0; i < 3; ++i) {
@@ -224,6 +349,4 @@ MathProblem MathGenerator::generateProblem(int previousResult,
     } while (!unique);
     problem.options[i] = wrong;
   }
-
-  return problem;
 }
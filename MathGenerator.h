@@ -1,7 +1,11 @@
 #ifndef MATHGENERATOR_H
 #define MATHGENERATOR_H
 
+#include "GenerationRules.h"
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 enum class Difficulty {
@@ -12,26 +16,125 @@ enum class Difficulty {
   MASTER  // +, -, *, /, sqrt, cbrt
 };
 
+// Non-owning view of a problem: the game reads generated problems and
+// problems stored in a memory-mapped ProblemBank through the same type.
+struct ProblemView {
+  std::string_view question;
+  int correctAnswer = 0;
+  const int *options = nullptr; // 3 options: Left, Up, Right
+  int correctOptionIndex = 0;
+  char op = 0; // 0 when the operator is unknown (curated banks)
+  int operandA = 0;
+  int operandB = 0;
+};
+
 struct MathProblem {
   std::string question;
   int correctAnswer; // For simplicity, we'll stick to integer answers mostly,
                      // or rounded
-  std::vector<int> options; // 3 options: Left, Up, Right mapping
+  std::array<int, 3> options{}; // Left, Up, Right; inline, so generating a
+                                // problem does not allocate
   int correctOptionIndex;   // 0 for Left, 1 for Up, 2 for Right
+
+  // Structured form of the question: 's' is sqrt(operandA), 'c' is
+  // cbrt(operandA); operandB is unused for both.
+  char op = '+';
+  int operandA = 0;
+  int operandB = 0;
+
+  // Valid until this problem is modified or destroyed.
+  ProblemView view() const {
+    ProblemView v;
+    v.question = question;
+    v.correctAnswer = correctAnswer;
+    v.options = options.data();
+    v.correctOptionIndex = correctOptionIndex;
+    v.op = op;
+    v.operandA = operandA;
+    v.operandB = operandB;
+    return v;
+  }
 };
 
+class ProblemFilter;
+class ReviewScheduler;
+
 class MathGenerator {
 public:
+  // Problems chain through previousResult in runs of this length; the first
+  // problem of each run starts fresh. Matches the challenges per level.
+  static const int kChainLength = 10;
+
   MathGenerator();
   void setDifficulty(Difficulty diff);
   MathProblem generateProblem(int previousResult, int challengesPassed);
   void startNewLevel();
 
+  // Seeded mode: every random draw comes from a counter-based stream keyed by
+  // (seed, level, index), so the same seed gives everyone the same sequence.
+  void setSeed(std::uint64_t seed);
+  void clearSeed();
+  bool isSeeded() const;
+  // Problem `index` (0-based) of the seeded sequence at `level`. Replays at
+  // most kChainLength problems, so the cost does not depend on `index`.
+  MathProblem problemAt(int level, std::uint64_t index);
+  // The same problem given the answer to problem index - 1 (unused at the
+  // start of a chain): walking a sequence in order generates each once.
+  MathProblem problemAfter(int level, std::uint64_t index, int previousResult);
+
+  // Candidates drawn per problem while looking for one that satisfies the
+  // difficulty band and the session filter; after that the best is used.
+  static const int kMaxRetries = 32;
+
+  // Only hand out problems whose ProblemClassifier score lies in
+  // [minScore, maxScore].
+  void setDifficultyBand(int minScore, int maxScore);
+  void clearDifficultyBand();
+
+  // Mix facts that are due in `scheduler` back in: while any fact is due,
+  // about `rate` (0.0 to 1.0) of the problems are reviews. Reviews never
+  // chain and are skipped in seeded mode so shared sequences stay identical.
+  void setReviewScheduler(ReviewScheduler *scheduler, float rate);
+  MathProblem problemFromFact(char op, int a, int b);
+
+  // Regenerate problems that `filter` has seen recently, and record every
+  // problem handed out in it. Skipped in seeded mode and for reviews.
+  void setSessionFilter(ProblemFilter *filter);
+
+  // Operators, weights and operand ranges per Difficulty; the built-in rules
+  // unless replaced.
+  void setRules(const GenerationRules &rules);
+  const GenerationRules &getRules() const;
+
 private:
   Difficulty currentDifficulty;
   std::vector<int>
       usedOperands; // Track used 'b' operands for the current level
+  MathProblem generateCandidate(int previousResult, int challengesPassed);
+  void fillOptions(MathProblem &problem);
   int generateRandomNumber(int min, int max);
+  int nextRandom();
+  void beginStream(int level, std::uint64_t index);
+  int permutedOperand(int min, int max);
+  int uniqueOperand(int min, int max);
+
+  GenerationRules rules;
+
+  bool seeded;
+  std::uint64_t seed;
+  std::uint64_t levelKey;  // Key for (seed, level)
+  std::uint64_t streamKey; // Key for (seed, level, index)
+  std::uint64_t streamCounter;
+  std::uint64_t streamIndex;
+
+  bool useBand;
+  int bandMin;
+  int bandMax;
+
+  ReviewScheduler *reviews;
+  float reviewRate;
+
+  ProblemFilter *sessionFilter;
 };
 
 #endif // MATHGENERATOR_H
@@ -0,0 +1,391 @@
+#include "Metrics.h"
+#include <arpa/inet.h>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const int kDifficulties = 5;
+const int kOps = 6; // + - * / sqrt cbrt
+const int kOutcomes = 3;
+const char *const kDifficultyLabels[kDifficulties] = {"easy", "medium", "hard",
+                                                      "expert", "master"};
+const char *const kOpLabels[kOps] = {"add", "sub", "mul",
+                                     "div", "sqrt", "cbrt"};
+const char *const kOutcomeNames[kOutcomes] = {"correct", "wrong", "timeout"};
+
+// Histogram upper bounds, in the unit each one is recorded in.
+const int kBuckets = 8;
+const std::uint64_t kFrameBoundsUs[kBuckets] = {1000,  2000,  4000,  8000,
+                                                16000, 32000, 64000, 128000};
+const std::uint64_t kLatencyBoundsMs[kBuckets] = {500,  1000, 2000,  3000,
+                                                  5000, 8000, 13000, 20000};
+
+// Every metric is a slot in one flat array so that blocks can be summed
+// without knowing what they hold. A histogram is kBuckets + 1 bucket counts
+// (the last is +Inf) followed by the sum and the count.
+const int kHistogramSlots = kBuckets + 3;
+const int kGenerated = 0;
+const int kAnswers = kGenerated + kDifficulties * kOps;
+const int kRetries = kAnswers + kOutcomes * kDifficulties * kOps;
+const int kLevel = kRetries + 1; // A maximum, not a sum
+const int kFrameTime = kLevel + 1;
+const int kLatency = kFrameTime + kHistogramSlots;
+const int kSlots = kLatency + kHistogramSlots;
+
+struct alignas(64) ThreadCounters {
+  std::atomic<std::uint64_t> values[kSlots];
+};
+
+struct MetricsState {
+  std::mutex mutex; // Guards live, retired and the server lifecycle
+  std::vector<ThreadCounters *> live;
+  std::uint64_t retired[kSlots] = {}; // Totals of threads that have exited
+  int listenFd = -1;
+  std::string socketPath; // Unlinked on stop() when listening on a socket
+  std::thread server;
+  std::atomic<bool> stopping{false};
+};
+
+MetricsState &state() {
+  static MetricsState s;
+  return s;
+}
+
+void collect(const ThreadCounters &counters, std::uint64_t *totals) {
+  for (int i = 0; i < kSlots; ++i) {
+    std::uint64_t v = counters.values[i].load(std::memory_order_relaxed);
+    if (i == kLevel)
+      totals[i] = v > totals[i] ? v : totals[i];
+    else
+      totals[i] += v;
+  }
+}
+
+// Registers the thread's block on first use and folds it into the retired
+// totals when the thread exits, so short-lived threads do not pile up.
+struct ThreadSlot {
+  ThreadCounters *counters = nullptr;
+  ~ThreadSlot() {
+    if (counters == nullptr)
+      return;
+    MetricsState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    collect(*counters, s.retired);
+    for (auto &c : s.live)
+      if (c == counters) {
+        c = s.live.back();
+        s.live.pop_back();
+        break;
+      }
+    delete counters;
+  }
+};
+
+ThreadCounters &local() {
+  thread_local ThreadSlot slot;
+  if (slot.counters == nullptr) {
+    ThreadCounters *counters = new ThreadCounters();
+    MetricsState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.live.push_back(counters);
+    slot.counters = counters;
+  }
+  return *slot.counters;
+}
+
+// Only the owning thread writes its block, so a plain load and store is
+// enough; no read-modify-write is needed on the hot path.
+void add(int slot, std::uint64_t n) {
+  std::atomic<std::uint64_t> &v = local().values[slot];
+  v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void observe(int base, const std::uint64_t *bounds, std::uint64_t value) {
+  int bucket = 0;
+  while (bucket < kBuckets && value > bounds[bucket])
+    ++bucket;
+  add(base + bucket, 1);
+  add(base + kBuckets + 1, value);
+  add(base + kBuckets + 2, 1);
+}
+
+int opIndex(char op) {
+  switch (op) {
+  case '+':
+    return 0;
+  case '-':
+    return 1;
+  case '*':
+    return 2;
+  case '/':
+    return 3;
+  case 's':
+    return 4;
+  case 'c':
+    return 5;
+  }
+  return -1;
+}
+
+void appendf(std::string &out, const char *format, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, format);
+  int n = std::vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (n > 0)
+    out.append(line, n < (int)sizeof(line) ? n : (int)sizeof(line) - 1);
+}
+
+void renderHistogram(std::string &out, const char *name, const char *help,
+                     const std::uint64_t *totals, int base,
+                     const std::uint64_t *bounds, double scale) {
+  appendf(out, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+  std::uint64_t cumulative = 0;
+  for (int b = 0; b < kBuckets; ++b) {
+    cumulative += totals[base + b];
+    appendf(out, "%s_bucket{le=\"%g\"} %llu\n", name, bounds[b] * scale,
+            (unsigned long long)cumulative);
+  }
+  cumulative += totals[base + kBuckets];
+  appendf(out, "%s_bucket{le=\"+Inf\"} %llu\n", name,
+          (unsigned long long)cumulative);
+  appendf(out, "%s_sum %g\n", name, totals[base + kBuckets + 1] * scale);
+  appendf(out, "%s_count %llu\n", name,
+          (unsigned long long)totals[base + kBuckets + 2]);
+}
+
+void serve(int client) {
+  // The request itself does not matter; read it so the client sees a clean
+  // close, then answer with the current totals.
+  char request[1024];
+  pollfd pfd{client, POLLIN, 0};
+  if (poll(&pfd, 1, 1000) > 0)
+    (void)read(client, request, sizeof(request));
+
+  std::string body = Metrics::render();
+  std::string response = "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: " +
+                         std::to_string(body.size()) + "\r\n\r\n" + body;
+  const char *data = response.data();
+  std::size_t left = response.size();
+  while (left > 0) {
+    ssize_t n = write(client, data, left);
+    if (n <= 0)
+      break;
+    data += n;
+    left -= (std::size_t)n;
+  }
+  close(client);
+}
+
+void serverLoop(int listenFd) {
+  MetricsState &s = state();
+  while (!s.stopping.load(std::memory_order_acquire)) {
+    pollfd pfd{listenFd, POLLIN, 0};
+    if (poll(&pfd, 1, 100) <= 0)
+      continue;
+    int client = accept(listenFd, nullptr, nullptr);
+    if (client >= 0)
+      serve(client);
+  }
+}
+
+int listenOn(const std::string &address, std::string &socketPath) {
+  // "unix:" names a socket path, relative or not; otherwise a leading '/'
+  // does.
+  std::string path = address;
+  bool unixSocket = !path.empty() && path[0] == '/';
+  if (path.compare(0, 5, "unix:") == 0) {
+    path = path.substr(5);
+    unixSocket = true;
+  }
+
+  int fd;
+  if (unixSocket) {
+    sockaddr_un addr{};
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+      return -1;
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+      return -1;
+    // A socket left behind by a previous run is replaced; any other file
+    // is the user's and makes bind() fail.
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+      unlink(path.c_str());
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+    }
+    socketPath = path;
+  } else {
+    char *end = nullptr;
+    long port = std::strtol(path.c_str(), &end, 10);
+    if (path.empty() || *end != '\0' || port <= 0 || port > 65535)
+      return -1;
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((std::uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+      return -1;
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(fd, (sockaddr *)&addr, sizeof(addr)) != 0) {
+      close(fd);
+      return -1;
+    }
+  }
+  if (listen(fd, 8) != 0) {
+    close(fd);
+    if (!socketPath.empty())
+      unlink(socketPath.c_str());
+    socketPath.clear();
+    return -1;
+  }
+  return fd;
+}
+
+} // namespace
+
+std::atomic<bool> Metrics::active(false);
+
+bool Metrics::start(const std::string &address) {
+  MetricsState &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  if (s.listenFd >= 0)
+    return false;
+  s.listenFd = listenOn(address, s.socketPath);
+  if (s.listenFd < 0)
+    return false;
+  s.stopping.store(false);
+  s.server = std::thread(serverLoop, s.listenFd);
+  active.store(true, std::memory_order_release);
+  return true;
+}
+
+void Metrics::stop() {
+  MetricsState &s = state();
+  if (!active.exchange(false))
+    return;
+  s.stopping.store(true, std::memory_order_release);
+  s.server.join();
+
+  std::lock_guard<std::mutex> lock(s.mutex);
+  close(s.listenFd);
+  s.listenFd = -1;
+  if (!s.socketPath.empty())
+    unlink(s.socketPath.c_str());
+  s.socketPath.clear();
+}
+
+void Metrics::problemGenerated(Difficulty difficulty, char op) {
+  int o = opIndex(op);
+  if (!enabled() || o < 0)
+    return;
+  add(kGenerated + (int)difficulty * kOps + o, 1);
+}
+
+void Metrics::answer(Difficulty difficulty, char op, AnswerOutcome outcome,
+                     std::uint64_t latencyMs) {
+  if (!enabled())
+    return;
+  int o = opIndex(op);
+  if (o >= 0)
+    add(kAnswers + ((int)outcome * kDifficulties + (int)difficulty) * kOps + o,
+        1);
+  if (outcome != AnswerOutcome::TIMEOUT)
+    observe(kLatency, kLatencyBoundsMs, latencyMs);
+}
+
+void Metrics::generatorRetries(int retries) {
+  if (!enabled() || retries <= 0)
+    return;
+  add(kRetries, (std::uint64_t)retries);
+}
+
+void Metrics::levelReached(int level) {
+  if (!enabled())
+    return;
+  std::atomic<std::uint64_t> &v = local().values[kLevel];
+  if ((std::uint64_t)level > v.load(std::memory_order_relaxed))
+    v.store((std::uint64_t)level, std::memory_order_relaxed);
+}
+
+void Metrics::frameTime(std::uint64_t us) {
+  if (!enabled())
+    return;
+  observe(kFrameTime, kFrameBoundsUs, us);
+}
+
+std::string Metrics::render() {
+  std::uint64_t totals[kSlots];
+  {
+    MetricsState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    std::memcpy(totals, s.retired, sizeof(totals));
+    for (ThreadCounters *counters : s.live)
+      collect(*counters, totals);
+  }
+
+  std::string out;
+  appendf(out, "# HELP unlimitedmath_problems_generated_total Problems shown "
+               "to the player.\n"
+               "# TYPE unlimitedmath_problems_generated_total counter\n");
+  for (int d = 0; d < kDifficulties; ++d)
+    for (int o = 0; o < kOps; ++o)
+      appendf(out,
+              "unlimitedmath_problems_generated_total{difficulty=\"%s\","
+              "op=\"%s\"} %llu\n",
+              kDifficultyLabels[d], kOpLabels[o],
+              (unsigned long long)totals[kGenerated + d * kOps + o]);
+
+  appendf(out, "# HELP unlimitedmath_answers_total Answers by outcome.\n"
+               "# TYPE unlimitedmath_answers_total counter\n");
+  for (int r = 0; r < kOutcomes; ++r)
+    for (int d = 0; d < kDifficulties; ++d)
+      for (int o = 0; o < kOps; ++o)
+        appendf(out,
+                "unlimitedmath_answers_total{outcome=\"%s\",difficulty=\"%s\","
+                "op=\"%s\"} %llu\n",
+                kOutcomeNames[r], kDifficultyLabels[d], kOpLabels[o],
+                (unsigned long long)
+                    totals[kAnswers + (r * kDifficulties + d) * kOps + o]);
+
+  appendf(out,
+          "# HELP unlimitedmath_generator_retries_total Candidates the "
+          "generator rejected.\n"
+          "# TYPE unlimitedmath_generator_retries_total counter\n"
+          "unlimitedmath_generator_retries_total %llu\n",
+          (unsigned long long)totals[kRetries]);
+  appendf(out,
+          "# HELP unlimitedmath_level_reached Highest level reached.\n"
+          "# TYPE unlimitedmath_level_reached gauge\n"
+          "unlimitedmath_level_reached %llu\n",
+          (unsigned long long)totals[kLevel]);
+
+  renderHistogram(out, "unlimitedmath_frame_seconds",
+                  "Time to draw and present one frame.", totals, kFrameTime,
+                  kFrameBoundsUs, 1e-6);
+  renderHistogram(out, "unlimitedmath_answer_latency_seconds",
+                  "Time from showing a problem to the answer.", totals,
+                  kLatency, kLatencyBoundsMs, 1e-3);
+  return out;
+}
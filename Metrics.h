@@ -0,0 +1,40 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "MathGenerator.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+enum class AnswerOutcome { CORRECT, WRONG, TIMEOUT };
+
+// Opt-in Prometheus endpoint. start() listens on a localhost TCP port or a
+// Unix socket and answers every HTTP request with the text exposition format.
+// Each thread counts into its own cache-line aligned block of atomics that
+// only it writes; the blocks are summed when a scrape comes in. While
+// metrics are off, recording is a single relaxed atomic load.
+class Metrics {
+public:
+  // `address` is a port number ("9464", bound to 127.0.0.1) or a socket
+  // path ("/tmp/unlimitedmath.sock", or "unix:" and any path, such as
+  // "unix:metrics.sock"). Only a stale socket at the path is replaced.
+  static bool start(const std::string &address);
+  static void stop();
+
+  static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+  static void problemGenerated(Difficulty difficulty, char op);
+  static void answer(Difficulty difficulty, char op, AnswerOutcome outcome,
+                     std::uint64_t latencyMs);
+  static void generatorRetries(int retries);
+  static void levelReached(int level);
+  static void frameTime(std::uint64_t us);
+
+  // Current totals in Prometheus text format (what a scrape returns).
+  static std::string render();
+
+private:
+  static std::atomic<bool> active;
+};
+
+#endif // METRICS_H
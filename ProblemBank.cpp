@@ -0,0 +1,265 @@
+#include "ProblemBank.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(int) == sizeof(std::int32_t),
+              "bank options are handed out as int");
+
+const char *ProblemBank::kDirectory = "banks";
+const char *ProblemBank::kExtension = ".umb";
+
+static const char kMagic[4] = {'U', 'M', 'P', 'B'};
+static const std::uint32_t kVersion = 1;
+
+ProblemBank::ProblemBank()
+    : data(nullptr), mappedSize(0), records(nullptr), text(nullptr),
+      textSize(0), count(0) {}
+
+ProblemBank::~ProblemBank() { close(); }
+
+bool ProblemBank::open(const std::string &path) {
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(BankHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void *addr =
+      mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+
+  data = static_cast<const unsigned char *>(addr);
+  mappedSize = (std::size_t)st.st_size;
+
+  // Only the header is validated; records are bounds-checked on access.
+  BankHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  bool valid = std::memcmp(header.magic, kMagic, 4) == 0 &&
+               header.version == kVersion &&
+               header.recordsOffset % alignof(BankRecord) == 0 &&
+               header.recordsOffset <= mappedSize &&
+               header.count <=
+                   (mappedSize - header.recordsOffset) / sizeof(BankRecord) &&
+               header.textOffset <= mappedSize &&
+               header.textSize <= mappedSize - header.textOffset;
+  if (!valid) {
+    close();
+    return false;
+  }
+  records = reinterpret_cast<const BankRecord *>(data + header.recordsOffset);
+  text = reinterpret_cast<const char *>(data + header.textOffset);
+  textSize = (std::size_t)header.textSize;
+  count = (std::size_t)header.count;
+  return true;
+}
+
+void ProblemBank::close() {
+  if (data != nullptr)
+    munmap(const_cast<unsigned char *>(data), mappedSize);
+  data = nullptr;
+  mappedSize = 0;
+  records = nullptr;
+  text = nullptr;
+  textSize = 0;
+  count = 0;
+}
+
+bool ProblemBank::isOpen() const { return data != nullptr; }
+
+std::size_t ProblemBank::size() const { return count; }
+
+ProblemView ProblemBank::at(std::size_t index) const {
+  const BankRecord &record = records[index];
+  ProblemView view;
+  if ((std::size_t)record.questionOffset + record.questionLength <= textSize)
+    view.question = std::string_view(text + record.questionOffset,
+                                     record.questionLength);
+  view.correctAnswer = record.correctAnswer;
+  view.options = reinterpret_cast<const int *>(record.options);
+  view.correctOptionIndex = record.correctOptionIndex % 3;
+  view.op = record.op;
+  view.operandA = record.operandA;
+  view.operandB = record.operandB;
+  return view;
+}
+
+static std::string trim(const std::string &s) {
+  size_t start = s.find_first_not_of(" \t\r\"");
+  size_t end = s.find_last_not_of(" \t\r\"");
+  if (start == std::string::npos)
+    return "";
+  return s.substr(start, end - start + 1);
+}
+
+static bool parseInt(const std::string &s, std::int32_t &out) {
+  if (s.empty())
+    return false;
+  char *end = nullptr;
+  long value = std::strtol(s.c_str(), &end, 10);
+  if (*end != '\0')
+    return false;
+  out = (std::int32_t)value;
+  return true;
+}
+
+bool ProblemBank::convertCsv(const std::string &csvPath,
+                             const std::string &bankPath, std::string &error) {
+  std::ifstream csv(csvPath);
+  if (!csv.is_open()) {
+    error = "cannot read " + csvPath;
+    return false;
+  }
+
+  std::vector<BankRecord> out;
+  std::string textBlock;
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(csv, line)) {
+    lineNumber++;
+    if (trim(line).empty())
+      continue;
+
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+      size_t comma = line.find(',', start);
+      fields.push_back(trim(line.substr(start, comma - start)));
+      if (comma == std::string::npos)
+        break;
+      start = comma + 1;
+    }
+
+    BankRecord record = {};
+    if (fields.size() < 2 || !parseInt(fields[1], record.correctAnswer)) {
+      if (out.empty() && lineNumber == 1)
+        continue; // Header
+      error = csvPath + ":" + std::to_string(lineNumber) +
+              ": expected question,answer[,wrong,wrong]";
+      return false;
+    }
+    const std::string &question = fields[0];
+    if (question.size() > 0xFFFF ||
+        textBlock.size() + question.size() > 0xFFFFFFFFu) {
+      error = csvPath + ":" + std::to_string(lineNumber) +
+              ": question too long for the bank format";
+      return false;
+    }
+
+    // Structured form for reviews and scoring, when the question allows it.
+    int a = 0, b = 0, consumed = 0;
+    char op = 0;
+    if (std::sscanf(question.c_str(), "%d %c %d%n", &a, &op, &b, &consumed) ==
+            3 &&
+        consumed == (int)question.size() && std::strchr("+-*/", op)) {
+      record.op = op;
+      record.operandA = a;
+      record.operandB = b;
+    } else if (std::sscanf(question.c_str(), "sqrt(%d)", &a) == 1) {
+      record.op = 's';
+      record.operandA = a;
+    } else if (std::sscanf(question.c_str(), "cbrt(%d)", &a) == 1) {
+      record.op = 'c';
+      record.operandA = a;
+    }
+
+    // Deterministic placement and distractors, so a bank plays the same for
+    // every learner.
+    std::uint32_t h = (std::uint32_t)out.size() * 2654435761u;
+    record.correctOptionIndex = (std::uint8_t)((h >> 16) % 3);
+    std::int32_t wrong[2] = {};
+    bool given[2];
+    std::string where = csvPath + ":" + std::to_string(lineNumber) + ": ";
+    for (int i = 0; i < 2; ++i) {
+      given[i] = fields.size() > (size_t)(2 + i) && !fields[2 + i].empty();
+      if (given[i] && !parseInt(fields[2 + i], wrong[i])) {
+        error = where + "wrong answer '" + fields[2 + i] + "' is not a number";
+        return false;
+      }
+      if (given[i] && wrong[i] == record.correctAnswer) {
+        error = where + "wrong answer equals the answer";
+        return false;
+      }
+    }
+    if (given[0] && given[1] && wrong[0] == wrong[1]) {
+      error = where + "both wrong answers are the same";
+      return false;
+    }
+    // Missing ones are generated below and above the answer, away from the
+    // one that was given.
+    for (int i = 0; i < 2; ++i) {
+      if (given[i])
+        continue;
+      int step = i == 0 ? -1 : 1;
+      int offset = 1 + (int)((h >> (8 + 4 * i)) % 5);
+      wrong[i] = record.correctAnswer + step * offset;
+      while (given[1 - i] && wrong[i] == wrong[1 - i])
+        wrong[i] += step;
+    }
+    int w = 0;
+    for (int i = 0; i < 3; ++i)
+      record.options[i] = i == record.correctOptionIndex ? record.correctAnswer
+                                                         : wrong[w++];
+
+    record.questionOffset = (std::uint32_t)textBlock.size();
+    record.questionLength = (std::uint16_t)question.size();
+    textBlock += question;
+    out.push_back(record);
+  }
+
+  BankHeader header = {};
+  std::memcpy(header.magic, kMagic, 4);
+  header.version = kVersion;
+  header.count = out.size();
+  header.recordsOffset = sizeof(BankHeader);
+  header.textOffset = header.recordsOffset + out.size() * sizeof(BankRecord);
+  header.textSize = textBlock.size();
+
+  std::FILE *file = std::fopen(bankPath.c_str(), "wb");
+  if (file == nullptr) {
+    error = "cannot write " + bankPath;
+    return false;
+  }
+  bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+            std::fwrite(out.data(), sizeof(BankRecord), out.size(), file) ==
+                out.size() &&
+            std::fwrite(textBlock.data(), 1, textBlock.size(), file) ==
+                textBlock.size();
+  ok = std::fclose(file) == 0 && ok;
+  if (!ok)
+    error = "failed writing " + bankPath;
+  return ok;
+}
+
+std::vector<std::string> ProblemBank::list() {
+  std::vector<std::string> names;
+  DIR *dir = opendir(kDirectory);
+  if (dir == nullptr)
+    return names;
+  const size_t extLen = std::strlen(kExtension);
+  while (struct dirent *entry = readdir(dir)) {
+    std::string file = entry->d_name;
+    if (file.size() > extLen &&
+        file.compare(file.size() - extLen, extLen, kExtension) == 0)
+      names.push_back(file.substr(0, file.size() - extLen));
+  }
+  closedir(dir);
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+std::string ProblemBank::pathFor(const std::string &name) {
+  return std::string(kDirectory) + "/" + name + kExtension;
+}
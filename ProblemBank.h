@@ -0,0 +1,71 @@
+#ifndef PROBLEMBANK_H
+#define PROBLEMBANK_H
+
+#include "MathGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A curated, fixed list of problems stored in a packed binary file:
+//
+//   BankHeader | BankRecord[count] | question text
+//
+// Each record points into the text block by offset and length. Opening a bank
+// maps the file and checks the header, so it takes the same time for any
+// size; at() returns views straight into the mapping.
+class ProblemBank {
+public:
+  static const char *kDirectory; // Where the game looks for banks
+  static const char *kExtension;
+
+  ProblemBank();
+  ~ProblemBank();
+  ProblemBank(const ProblemBank &) = delete;
+  ProblemBank &operator=(const ProblemBank &) = delete;
+
+  bool open(const std::string &path);
+  void close();
+  bool isOpen() const;
+
+  std::size_t size() const;
+  ProblemView at(std::size_t index) const; // index < size()
+
+  // Writes a bank from CSV lines of `question,answer[,wrong,wrong]`. A first
+  // line whose answer is not a number is treated as a header.
+  static bool convertCsv(const std::string &csvPath,
+                         const std::string &bankPath, std::string &error);
+  // Bank names (file names without extension) found in kDirectory.
+  static std::vector<std::string> list();
+  static std::string pathFor(const std::string &name);
+
+private:
+  struct BankHeader {
+    char magic[4]; // "UMPB"
+    std::uint32_t version;
+    std::uint64_t count;
+    std::uint64_t recordsOffset;
+    std::uint64_t textOffset;
+    std::uint64_t textSize;
+  };
+
+  struct BankRecord {
+    std::uint32_t questionOffset; // Into the text block
+    std::uint16_t questionLength;
+    char op; // 0 when the question is not a plain "a op b"
+    std::uint8_t correctOptionIndex;
+    std::int32_t operandA;
+    std::int32_t operandB;
+    std::int32_t correctAnswer;
+    std::int32_t options[3];
+  };
+
+  const unsigned char *data;
+  std::size_t mappedSize;
+  const BankRecord *records;
+  const char *text;
+  std::size_t textSize;
+  std::size_t count;
+};
+
+#endif // PROBLEMBANK_H
@@ -0,0 +1,98 @@
+#include "ProblemClassifier.h"
+#include <cstdlib>
+
+using namespace classifier_tables;
+
+int ProblemClassifier::digitCount(int value) {
+  unsigned v = (unsigned)std::abs(value);
+  int digits = 1;
+  while (v >= 10) {
+    v /= 10;
+    digits++;
+  }
+  return digits;
+}
+
+int ProblemClassifier::carries(int a, int b) {
+  unsigned x = (unsigned)std::abs(a);
+  unsigned y = (unsigned)std::abs(b);
+  int carry = 0;
+  int count = 0;
+  while (x != 0 || y != 0) {
+    carry = kAddCarry[carry][x % 10][y % 10];
+    count += carry;
+    x /= 10;
+    y /= 10;
+  }
+  return count;
+}
+
+int ProblemClassifier::borrows(int a, int b) {
+  unsigned x = (unsigned)std::abs(a);
+  unsigned y = (unsigned)std::abs(b);
+  if (x < y) { // Learners compute the larger minus the smaller
+    unsigned t = x;
+    x = y;
+    y = t;
+  }
+  int borrow = 0;
+  int count = 0;
+  while (x != 0 || y != 0) {
+    borrow = kSubBorrow[borrow][x % 10][y % 10];
+    count += borrow;
+    x /= 10;
+    y /= 10;
+  }
+  return count;
+}
+
+int ProblemClassifier::timesHardness(int a, int b) {
+  a = std::abs(a);
+  b = std::abs(b);
+  if (a > 12 || b > 12)
+    return 10;
+  return kTimesHardness[a][b];
+}
+
+int ProblemClassifier::score(char op, int a, int b) {
+  int s = 0;
+  switch (op) {
+  case '+': {
+    int digits = digitCount(std::abs(a) > std::abs(b) ? a : b);
+    s = 10 * digits + 15 * carries(a, b);
+    break;
+  }
+  case '-': {
+    int digits = digitCount(std::abs(a) > std::abs(b) ? a : b);
+    s = 10 * digits + 15 * borrows(a, b);
+    if (b > a)
+      s += 10; // Negative result
+    break;
+  }
+  case '*':
+    s = 15 + 5 * timesHardness(a, b);
+    if (std::abs(a) > 12 || std::abs(b) > 12)
+      s += 10 * (digitCount(a) + digitCount(b) - 2);
+    break;
+  case '/': {
+    int quotient = b != 0 ? a / b : 0;
+    s = 20 + 5 * timesHardness(b, quotient);
+    if (std::abs(quotient) > 12)
+      s += 10 * (digitCount(quotient) - 1);
+    break;
+  }
+  case 's':
+    s = 40 + 10 * (digitCount(a) - 1);
+    break;
+  case 'c':
+    s = 55 + 10 * (digitCount(a) - 1);
+    break;
+  }
+  if (s > kMaxScore)
+    s = kMaxScore;
+  return s;
+}
+
+int ProblemClassifier::score(const MathProblem &problem) {
+  return score(problem.op, problem.operandA, problem.operandB);
+}
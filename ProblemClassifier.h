@@ -0,0 +1,74 @@
+#ifndef PROBLEMCLASSIFIER_H
+#define PROBLEMCLASSIFIER_H
+
+#include "MathGenerator.h"
+#include <array>
+#include <cstdint>
+
+// Static difficulty score for a single problem. Scoring only walks the digits
+// of the operands through the lookup tables below, all of which are built at
+// compile time.
+class ProblemClassifier {
+public:
+  static const int kMaxScore = 100;
+
+  static int score(const MathProblem &problem);
+  static int score(char op, int a, int b);
+
+  static int digitCount(int value);
+  static int carries(int a, int b);  // Carries in column addition a + b
+  static int borrows(int a, int b);  // Borrows in column subtraction a - b
+  static int timesHardness(int a, int b); // 0..10 for factors 0..12
+
+private:
+  ProblemClassifier() = delete;
+};
+
+namespace classifier_tables {
+
+// kAddCarry[carryIn][x][y] is 1 when column x + y + carryIn carries out.
+constexpr std::array<std::array<std::array<std::uint8_t, 10>, 10>, 2>
+makeAddCarry() {
+  std::array<std::array<std::array<std::uint8_t, 10>, 10>, 2> t{};
+  for (int c = 0; c < 2; ++c)
+    for (int x = 0; x < 10; ++x)
+      for (int y = 0; y < 10; ++y)
+        t[c][x][y] = (x + y + c >= 10) ? 1 : 0;
+  return t;
+}
+
+// kSubBorrow[borrowIn][x][y] is 1 when column x - y - borrowIn borrows.
+constexpr std::array<std::array<std::array<std::uint8_t, 10>, 10>, 2>
+makeSubBorrow() {
+  std::array<std::array<std::array<std::uint8_t, 10>, 10>, 2> t{};
+  for (int c = 0; c < 2; ++c)
+    for (int x = 0; x < 10; ++x)
+      for (int y = 0; y < 10; ++y)
+        t[c][x][y] = (x - y - c < 0) ? 1 : 0;
+  return t;
+}
+
+// Rough recall difficulty of each times-table row: x0, x1, x2, x5 and x10 are
+// easy, x7, x8 and x12 are the ones learners miss most.
+constexpr std::array<std::uint8_t, 13> kRowHardness = {0, 0, 1, 2, 2, 1, 3,
+                                                        5, 5, 4, 0, 3, 5};
+
+constexpr std::array<std::array<std::uint8_t, 13>, 13> makeTimesHardness() {
+  std::array<std::array<std::uint8_t, 13>, 13> t{};
+  for (int x = 0; x < 13; ++x)
+    for (int y = 0; y < 13; ++y) {
+      int h = kRowHardness[x] + kRowHardness[y];
+      if (x == y && h > 0)
+        h -= 1; // Squares are drilled more often
+      t[x][y] = (std::uint8_t)h;
+    }
+  return t;
+}
+
+inline constexpr auto kAddCarry = makeAddCarry();
+inline constexpr auto kSubBorrow = makeSubBorrow();
+inline constexpr auto kTimesHardness = makeTimesHardness();
+
+} // namespace classifier_tables
+
+#endif // PROBLEMCLASSIFIER_H
@@ -0,0 +1,99 @@
+#include "ProblemFilter.h"
+#include <cmath>
+#include <utility>
+
+ProblemFilter::ProblemFilter(std::size_t window, double falsePositiveRate)
+    : current(0), insertedInCurrent(0), windowSize(window ? window : 1) {
+  // Both generations are queried, so each gets half the error budget.
+  double p = falsePositiveRate / 2.0;
+  double ln2 = std::log(2.0);
+  double bits = -(double)windowSize * std::log(p) / (ln2 * ln2);
+  blockCount = (std::size_t)std::ceil(bits / 512.0);
+  if (blockCount == 0)
+    blockCount = 1;
+  hashCount = (int)std::lround(bits / windowSize * ln2);
+  if (hashCount < 1)
+    hashCount = 1;
+  if (hashCount > 16)
+    hashCount = 16;
+  generations[0].resize(blockCount);
+  generations[1].resize(blockCount);
+  clear();
+}
+
+std::uint64_t ProblemFilter::hashProblem(char op, int a, int b) {
+  // 7 * 8 and 8 * 7 are the same fact, as in ReviewScheduler::normalize().
+  if ((op == '+' || op == '*') && b < a)
+    std::swap(a, b);
+  std::uint64_t x = ((std::uint64_t)(std::uint32_t)a << 32) ^
+                    (std::uint32_t)b ^
+                    ((std::uint64_t)(unsigned char)op << 56);
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+bool ProblemFilter::testBlock(const std::vector<Block> &generation,
+                              std::uint64_t h) const {
+  const Block &block =
+      generation[(std::size_t)(((h >> 32) * blockCount) >> 32)];
+  std::uint32_t h1 = (std::uint32_t)h;
+  std::uint32_t h2 = (std::uint32_t)(h >> 41) | 1;
+  for (int i = 0; i < hashCount; ++i) {
+    std::uint32_t bit = (h1 + i * h2) & 511;
+    if ((block.words[bit >> 6] & (1ULL << (bit & 63))) == 0)
+      return false;
+  }
+  return true;
+}
+
+bool ProblemFilter::contains(char op, int a, int b) const {
+  std::uint64_t h = hashProblem(op, a, b);
+  return testBlock(generations[current], h) ||
+         testBlock(generations[1 - current], h);
+}
+
+void ProblemFilter::insert(char op, int a, int b) {
+  if (insertedInCurrent >= windowSize) {
+    // Rotate: forget the older generation and start filling it again.
+    current = 1 - current;
+    for (Block &block : generations[current])
+      for (std::uint64_t &word : block.words)
+        word = 0;
+    insertedInCurrent = 0;
+  }
+  std::uint64_t h = hashProblem(op, a, b);
+  Block &block =
+      generations[current][(std::size_t)(((h >> 32) * blockCount) >> 32)];
+  std::uint32_t h1 = (std::uint32_t)h;
+  std::uint32_t h2 = (std::uint32_t)(h >> 41) | 1;
+  for (int i = 0; i < hashCount; ++i) {
+    std::uint32_t bit = (h1 + i * h2) & 511;
+    block.words[bit >> 6] |= 1ULL << (bit & 63);
+  }
+  insertedInCurrent++;
+}
+
+void ProblemFilter::clear() {
+  for (std::vector<Block> &generation : generations)
+    for (Block &block : generation)
+      for (std::uint64_t &word : block.words)
+        word = 0;
+  current = 0;
+  insertedInCurrent = 0;
+}
+
+std::size_t ProblemFilter::window() const { return windowSize; }
+
+std::size_t ProblemFilter::memoryBytes() const {
+  return 2 * blockCount * sizeof(Block);
+}
+
+double ProblemFilter::expectedFalsePositiveRate() const {
+  double m = (double)blockCount * 512.0;
+  double perGeneration =
+      std::pow(1.0 - std::exp(-hashCount * (double)windowSize / m), hashCount);
+  return 1.0 - (1.0 - perGeneration) * (1.0 - perGeneration);
+}
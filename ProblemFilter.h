@@ -0,0 +1,43 @@
+#ifndef PROBLEMFILTER_H
+#define PROBLEMFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Remembers recently shown problems (operator plus operands, in either order
+// for + and *) so the generator can avoid repeating them. Two generations of
+// a blocked Bloom filter rotate every `window` insertions, so the last
+// `window` to 2 * `window` problems are remembered in a fixed amount of
+// memory. Each lookup touches a single 64-byte block per generation.
+class ProblemFilter {
+public:
+  explicit ProblemFilter(std::size_t window = 4096,
+                         double falsePositiveRate = 0.01);
+
+  bool contains(char op, int a, int b) const;
+  void insert(char op, int a, int b);
+  void clear();
+
+  std::size_t window() const;
+  std::size_t memoryBytes() const;
+  // Design false-positive rate for a lookup against two full generations.
+  double expectedFalsePositiveRate() const;
+
+private:
+  struct alignas(64) Block {
+    std::uint64_t words[8];
+  };
+
+  static std::uint64_t hashProblem(char op, int a, int b);
+  bool testBlock(const std::vector<Block> &generation, std::uint64_t h) const;
+
+  std::vector<Block> generations[2];
+  int current;
+  std::size_t insertedInCurrent;
+  std::size_t windowSize;
+  std::size_t blockCount;
+  int hashCount;
+};
+
+#endif // PROBLEMFILTER_H
@@ -0,0 +1,241 @@
+#include "ReviewScheduler.h"
+#include <chrono>
+#include <utility>
+
+static std::uint32_t hashFact(const Fact &fact) {
+  std::uint64_t x = ((std::uint64_t)(std::uint32_t)fact.a << 32) ^
+                    (std::uint32_t)fact.b ^
+                    ((std::uint64_t)(unsigned char)fact.op << 56);
+  x ^= x >> 33;
+  x *= 0xFF51AFD7ED558CCDULL;
+  x ^= x >> 33;
+  return (std::uint32_t)x;
+}
+
+ReviewScheduler::ReviewScheduler(std::size_t capacity) : maxFacts(capacity) {
+  std::size_t slots = 2;
+  while (slots < capacity * 2)
+    slots *= 2;
+  table.resize(slots);
+  for (std::vector<std::uint32_t> &heap : heaps)
+    heap.reserve(capacity);
+  mask = (std::uint32_t)(slots - 1);
+  clear();
+}
+
+Fact ReviewScheduler::normalize(char op, int a, int b) {
+  Fact fact;
+  fact.op = op;
+  fact.a = a;
+  fact.b = b;
+  if ((op == '+' || op == '*') && b < a)
+    std::swap(fact.a, fact.b);
+  if (op == 's' || op == 'c')
+    fact.b = 0;
+  return fact;
+}
+
+std::uint64_t ReviewScheduler::nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::size_t ReviewScheduler::bytesFor(std::size_t capacity) {
+  std::size_t slots = 2;
+  while (slots < capacity * 2)
+    slots *= 2;
+  return sizeof(ReviewScheduler) + slots * sizeof(Entry) +
+         kOrders * capacity * sizeof(std::uint32_t);
+}
+
+void ReviewScheduler::recordMiss(const Fact &fact, std::uint64_t now) {
+  if (fact.op == 0)
+    return; // Not a structured fact, e.g. a free-form bank question
+  std::uint32_t slot = findSlot(fact);
+  if (slot == kNoSlot) {
+    insert(fact, kFirstIntervalMs, now);
+    return;
+  }
+  // Start over: the fact has to be relearned.
+  table[slot].intervalMs = kFirstIntervalMs;
+  schedule(slot, now + kFirstIntervalMs);
+}
+
+void ReviewScheduler::recordSlow(const Fact &fact, std::uint64_t now) {
+  if (fact.op == 0)
+    return;
+  std::uint32_t slot = findSlot(fact);
+  if (slot == kNoSlot) {
+    insert(fact, 2 * kFirstIntervalMs, now);
+    return;
+  }
+  // Known but shaky: repeat at the same interval instead of growing it.
+  schedule(slot, now + table[slot].intervalMs);
+}
+
+void ReviewScheduler::recordCorrect(const Fact &fact, std::uint64_t now) {
+  std::uint32_t slot = findSlot(fact);
+  if (slot == kNoSlot)
+    return;
+  std::uint64_t interval = (std::uint64_t)table[slot].intervalMs * 5 / 2;
+  if (interval >= kRetireIntervalMs) {
+    erase(slot); // Learned
+    return;
+  }
+  table[slot].intervalMs = (std::uint32_t)interval;
+  schedule(slot, now + interval);
+}
+
+bool ReviewScheduler::takeDue(std::uint64_t now, Fact &out) {
+  if (heaps[DUE].empty())
+    return false;
+  std::uint32_t slot = heaps[DUE][0];
+  if (table[slot].dueMs > now)
+    return false;
+  out = table[slot].fact;
+  schedule(slot, now + kFirstIntervalMs / 2);
+  return true;
+}
+
+bool ReviewScheduler::contains(const Fact &fact) const {
+  return findSlot(fact) != kNoSlot;
+}
+
+std::size_t ReviewScheduler::size() const { return heaps[DUE].size(); }
+
+std::size_t ReviewScheduler::capacity() const { return maxFacts; }
+
+void ReviewScheduler::clear() {
+  for (Entry &entry : table)
+    entry.fact.op = 0;
+  for (std::vector<std::uint32_t> &heap : heaps)
+    heap.clear();
+}
+
+std::uint32_t ReviewScheduler::findSlot(const Fact &fact) const {
+  std::uint32_t slot = hashFact(fact) & mask;
+  while (table[slot].fact.op != 0) {
+    if (table[slot].fact == fact)
+      return slot;
+    slot = (slot + 1) & mask;
+  }
+  return kNoSlot;
+}
+
+std::uint32_t ReviewScheduler::insert(const Fact &fact,
+                                      std::uint32_t intervalMs,
+                                      std::uint64_t now) {
+  if (maxFacts == 0)
+    return kNoSlot;
+  if (size() >= maxFacts)
+    erase(heaps[EVICT][0]); // Full: drop what the learner needs least
+
+  std::uint32_t slot = hashFact(fact) & mask;
+  while (table[slot].fact.op != 0)
+    slot = (slot + 1) & mask;
+
+  Entry &entry = table[slot];
+  entry.fact = fact;
+  entry.intervalMs = intervalMs;
+  entry.dueMs = now + intervalMs;
+  for (int order = 0; order < kOrders; ++order) {
+    entry.heapPos[order] = (std::uint32_t)heaps[order].size();
+    heaps[order].push_back(slot);
+    siftUp((Order)order, entry.heapPos[order]);
+  }
+  return slot;
+}
+
+void ReviewScheduler::erase(std::uint32_t slot) {
+  for (int order = 0; order < kOrders; ++order) {
+    std::vector<std::uint32_t> &heap = heaps[order];
+    std::uint32_t pos = table[slot].heapPos[order];
+    std::uint32_t last = (std::uint32_t)heap.size() - 1;
+    if (pos != last) {
+      swapHeap((Order)order, pos, last);
+      heap.pop_back();
+      siftUp((Order)order, pos);
+      siftDown((Order)order, pos);
+    } else {
+      heap.pop_back();
+    }
+  }
+  table[slot].fact.op = 0;
+
+  // Backward-shift deletion keeps linear probing free of tombstones.
+  std::uint32_t hole = slot;
+  std::uint32_t j = slot;
+  while (true) {
+    j = (j + 1) & mask;
+    if (table[j].fact.op == 0)
+      break;
+    std::uint32_t home = hashFact(table[j].fact) & mask;
+    // Move the entry unless its home lies cyclically in (hole, j].
+    bool stays = (hole <= j) ? (hole < home && home <= j)
+                             : (hole < home || home <= j);
+    if (stays)
+      continue;
+    table[hole] = table[j];
+    for (int order = 0; order < kOrders; ++order)
+      heaps[order][table[hole].heapPos[order]] = hole;
+    table[j].fact.op = 0;
+    hole = j;
+  }
+}
+
+void ReviewScheduler::schedule(std::uint32_t slot, std::uint64_t dueMs) {
+  // The interval may have moved too, so both directions are tried.
+  table[slot].dueMs = dueMs;
+  for (int order = 0; order < kOrders; ++order) {
+    siftUp((Order)order, table[slot].heapPos[order]);
+    siftDown((Order)order, table[slot].heapPos[order]);
+  }
+}
+
+// Whether slot `a` belongs nearer the top of heap `order` than slot `b`.
+bool ReviewScheduler::above(Order order, std::uint32_t a,
+                            std::uint32_t b) const {
+  const Entry &x = table[a];
+  const Entry &y = table[b];
+  if (order == DUE)
+    return x.dueMs < y.dueMs;
+  return x.dueMs > y.dueMs ||
+         (x.dueMs == y.dueMs && x.intervalMs > y.intervalMs);
+}
+
+void ReviewScheduler::siftUp(Order order, std::uint32_t pos) {
+  const std::vector<std::uint32_t> &heap = heaps[order];
+  while (pos > 0) {
+    std::uint32_t parent = (pos - 1) / 2;
+    if (!above(order, heap[pos], heap[parent]))
+      break;
+    swapHeap(order, pos, parent);
+    pos = parent;
+  }
+}
+
+void ReviewScheduler::siftDown(Order order, std::uint32_t pos) {
+  const std::vector<std::uint32_t> &heap = heaps[order];
+  std::uint32_t n = (std::uint32_t)heap.size();
+  while (true) {
+    std::uint32_t top = pos;
+    std::uint32_t left = 2 * pos + 1;
+    std::uint32_t right = left + 1;
+    if (left < n && above(order, heap[left], heap[top]))
+      top = left;
+    if (right < n && above(order, heap[right], heap[top]))
+      top = right;
+    if (top == pos)
+      break;
+    swapHeap(order, pos, top);
+    pos = top;
+  }
+}
+
+void ReviewScheduler::swapHeap(Order order, std::uint32_t i, std::uint32_t j) {
+  std::vector<std::uint32_t> &heap = heaps[order];
+  std::swap(heap[i], heap[j]);
+  table[heap[i]].heapPos[order] = i;
+  table[heap[j]].heapPos[order] = j;
+}
@@ -0,0 +1,80 @@
+#ifndef REVIEWSCHEDULER_H
+#define REVIEWSCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A single arithmetic fact, normalized so that 7 * 8 and 8 * 7 are the same
+// fact. Uses the MathProblem operator codes ('s' = sqrt, 'c' = cbrt).
+struct Fact {
+  char op = 0;
+  int a = 0;
+  int b = 0;
+
+  bool operator==(const Fact &other) const {
+    return op == other.op && a == other.a && b == other.b;
+  }
+};
+
+// Spaced-repetition queue of facts a learner missed or answered slowly.
+// Facts live in a fixed-size open-addressing hash table and two heaps of
+// slots: a min-heap on due time picks the next review, a max-heap on due time
+// then interval picks the fact to drop when the scheduler is full. Every
+// operation is O(log n). All memory is allocated up front, so one learner
+// costs exactly bytesFor(capacity).
+class ReviewScheduler {
+public:
+  static const std::uint32_t kFirstIntervalMs = 30 * 1000;
+  static const std::uint32_t kRetireIntervalMs = 24 * 60 * 60 * 1000;
+
+  explicit ReviewScheduler(std::size_t capacity = 256);
+
+  static Fact normalize(char op, int a, int b);
+  static std::uint64_t nowMs(); // Monotonic clock used by the game
+  static std::size_t bytesFor(std::size_t capacity);
+
+  void recordMiss(const Fact &fact, std::uint64_t now);
+  void recordSlow(const Fact &fact, std::uint64_t now);
+  void recordCorrect(const Fact &fact, std::uint64_t now);
+
+  // Hands out the most overdue fact, if any is due, and pushes it back by a
+  // short retry delay until the answer is recorded.
+  bool takeDue(std::uint64_t now, Fact &out);
+
+  bool contains(const Fact &fact) const;
+  std::size_t size() const;
+  std::size_t capacity() const;
+  void clear();
+
+private:
+  static const std::uint32_t kNoSlot = 0xFFFFFFFFu;
+
+  // The two heaps: DUE puts the earliest due time on top, EVICT the fact the
+  // learner needs least (latest due, then longest interval).
+  enum Order { DUE, EVICT, kOrders };
+
+  struct Entry {
+    std::uint64_t dueMs;
+    std::uint32_t intervalMs;
+    std::uint32_t heapPos[kOrders];
+    Fact fact; // fact.op == 0 marks an empty slot
+  };
+
+  std::uint32_t findSlot(const Fact &fact) const;
+  std::uint32_t insert(const Fact &fact, std::uint32_t intervalMs,
+                       std::uint64_t now);
+  void erase(std::uint32_t slot);
+  void schedule(std::uint32_t slot, std::uint64_t dueMs);
+  bool above(Order order, std::uint32_t a, std::uint32_t b) const;
+  void siftUp(Order order, std::uint32_t pos);
+  void siftDown(Order order, std::uint32_t pos);
+  void swapHeap(Order order, std::uint32_t i, std::uint32_t j);
+
+  std::vector<Entry> table; // Power-of-two slots, at most half full
+  std::vector<std::uint32_t> heaps[kOrders];
+  std::size_t maxFacts;
+  std::uint32_t mask;
+};
+
+#endif // REVIEWSCHEDULER_H
@@ -0,0 +1,143 @@
+#include "Scoreboard.h"
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char *kSegmentName = "/unlimitedmath-scoreboard";
+
+static bool processAlive(std::int32_t pid) {
+  return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+Scoreboard::Scoreboard() : segment(nullptr), readOnly(false), mine(nullptr) {
+  playerName[0] = playerName[1] = 0;
+}
+
+Scoreboard::~Scoreboard() { close(); }
+
+bool Scoreboard::open(bool readOnly) {
+  if (segment != nullptr)
+    return true;
+  struct stat info;
+  int fd = readOnly ? shm_open(kSegmentName, O_RDONLY, 0) : -1;
+  if (fd >= 0 && (fstat(fd, &info) != 0 ||
+                  (std::size_t)info.st_size < sizeof(Segment))) {
+    ::close(fd); // Still being created; create it alongside
+    fd = -1;
+  }
+  if (fd < 0) {
+    fd = shm_open(kSegmentName, O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+      return false;
+    // The umask narrows the mode at creation; every user's games must be
+    // able to join, so the owner widens it again. Others cannot, and need not.
+    fchmod(fd, 0666);
+    // A fresh segment is zero-filled, which is a table of free slots.
+    if (ftruncate(fd, sizeof(Segment)) != 0) {
+      ::close(fd);
+      return false;
+    }
+  }
+  int protection = readOnly ? PROT_READ : PROT_READ | PROT_WRITE;
+  void *addr = mmap(nullptr, sizeof(Segment), protection, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+    return false;
+  segment = static_cast<Segment *>(addr);
+  this->readOnly = readOnly;
+  return true;
+}
+
+void Scoreboard::close() {
+  if (segment == nullptr)
+    return;
+  leave();
+  munmap(segment, sizeof(Segment));
+  segment = nullptr;
+}
+
+bool Scoreboard::join(const std::string &player) {
+  if (segment == nullptr || readOnly || mine != nullptr)
+    return mine != nullptr;
+
+  char name[16] = {};
+  std::strncpy(name, player.c_str(), sizeof(name) - 1);
+  std::memcpy(playerName, name, sizeof(playerName));
+
+  std::int32_t self = (std::int32_t)getpid();
+  for (Slot &slot : segment->slots) {
+    std::int32_t owner = slot.pid.load(std::memory_order_relaxed);
+    if (owner != 0 && processAlive(owner))
+      continue;
+    if (slot.pid.compare_exchange_strong(owner, self)) {
+      mine = &slot;
+      write(slot, self, 1, 0, 0, playerName);
+      return true;
+    }
+  }
+  return false; // Table full
+}
+
+void Scoreboard::leave() {
+  if (mine == nullptr)
+    return;
+  write(*mine, 0, 0, 0, 0, playerName);
+  mine = nullptr;
+}
+
+void Scoreboard::publish(int level, int score, int challengesPassed) {
+  if (mine == nullptr)
+    return;
+  write(*mine, (std::int32_t)getpid(), level, score, challengesPassed,
+        playerName);
+}
+
+void Scoreboard::write(Slot &slot, std::int32_t pid, int level, int score,
+                       int challengesPassed, const std::uint64_t player[2]) {
+  std::uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.level.store(level, std::memory_order_relaxed);
+  slot.score.store(score, std::memory_order_relaxed);
+  slot.challengesPassed.store(challengesPassed, std::memory_order_relaxed);
+  slot.player[0].store(player[0], std::memory_order_relaxed);
+  slot.player[1].store(player[1], std::memory_order_relaxed);
+  slot.pid.store(pid, std::memory_order_relaxed);
+  slot.sequence.store(seq + 2, std::memory_order_release);
+}
+
+int Scoreboard::snapshot(ScoreEntry *out, int max) const {
+  if (segment == nullptr)
+    return 0;
+  int count = 0;
+  for (const Slot &slot : segment->slots) {
+    if (count >= max)
+      break;
+    ScoreEntry entry;
+    std::uint64_t player[2];
+    std::uint32_t before, after;
+    do {
+      before = slot.sequence.load(std::memory_order_acquire);
+      entry.pid = slot.pid.load(std::memory_order_relaxed);
+      entry.level = slot.level.load(std::memory_order_relaxed);
+      entry.score = slot.score.load(std::memory_order_relaxed);
+      entry.challengesPassed =
+          slot.challengesPassed.load(std::memory_order_relaxed);
+      player[0] = slot.player[0].load(std::memory_order_relaxed);
+      player[1] = slot.player[1].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = slot.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+
+    if (entry.pid == 0 || !processAlive(entry.pid))
+      continue; // Free, or left behind by a crashed process
+    std::memcpy(entry.player, player, sizeof(entry.player));
+    entry.player[sizeof(entry.player) - 1] = '\0';
+    out[count++] = entry;
+  }
+  return count;
+}
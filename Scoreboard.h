@@ -0,0 +1,64 @@
+#ifndef SCOREBOARD_H
+#define SCOREBOARD_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// One live session as seen by a reader.
+struct ScoreEntry {
+  char player[16];
+  int pid;
+  int level;
+  int score;
+  int challengesPassed;
+};
+
+// Table of live game sessions in a POSIX shared-memory segment, shared by
+// every unlimitedmath process on the host. Each session owns one slot and is
+// its only writer; slots are seqlock-protected, so publishing is a handful of
+// atomic stores and readers never block the players.
+class Scoreboard {
+public:
+  static const int kMaxSessions = 64;
+
+  Scoreboard();
+  ~Scoreboard();
+
+  // Creates or attaches to the segment. A read-only board (the --scoreboard
+  // viewer) maps it without write access and cannot join.
+  bool open(bool readOnly = false);
+  void close();
+
+  // Claims a slot for this process (reusing slots of dead processes).
+  bool join(const std::string &player);
+  void leave();
+  void publish(int level, int score, int challengesPassed);
+
+  // Copies the live sessions into `out`; returns how many were written.
+  int snapshot(ScoreEntry *out, int max) const;
+
+private:
+  struct Slot {
+    alignas(64) std::atomic<std::uint32_t> sequence; // Odd while writing
+    std::atomic<std::int32_t> pid;                   // 0 = free
+    std::atomic<std::int32_t> level;
+    std::atomic<std::int32_t> score;
+    std::atomic<std::int32_t> challengesPassed;
+    std::atomic<std::uint64_t> player[2]; // Up to 15 bytes, NUL padded
+  };
+
+  struct Segment {
+    Slot slots[kMaxSessions];
+  };
+
+  void write(Slot &slot, std::int32_t pid, int level, int score,
+             int challengesPassed, const std::uint64_t player[2]);
+
+  Segment *segment;
+  bool readOnly;
+  Slot *mine;
+  std::uint64_t playerName[2];
+};
+
+#endif // SCOREBOARD_H
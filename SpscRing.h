@@ -0,0 +1,40 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer and one consumer thread.
+// Capacity must be a power of two.
+template <typename T, std::size_t Capacity> class SpscRing {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "capacity must be a power of two");
+
+public:
+  SpscRing() : head(0), tail(0) {}
+
+  bool push(const T &value) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= Capacity)
+      return false; // Full
+    items[h & (Capacity - 1)] = value;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &value) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+      return false; // Empty
+    value = items[t & (Capacity - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T items[Capacity];
+  alignas(64) std::atomic<std::size_t> head;
+  alignas(64) std::atomic<std::size_t> tail;
+};
+
+#endif // SPSCRING_H
@@ -0,0 +1,257 @@
+#include "Tracer.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const std::size_t kRingCapacity = 1 << 14; // Events per thread, power of two
+const std::chrono::milliseconds kFlushInterval(50);
+
+struct TraceEvent {
+  const char *name;
+  const char *category;
+  std::uint64_t timestampUs;
+  std::uint64_t durationUs;
+  char phase; // 'X' complete, 'i' instant
+};
+
+// Single-producer (the owning thread), single-consumer (the flusher) ring.
+struct ThreadRing {
+  alignas(64) std::atomic<std::uint64_t> head{0};
+  alignas(64) std::atomic<std::uint64_t> tail{0};
+  std::atomic<std::uint64_t> dropped{0};
+  unsigned threadId = 0;
+  bool retired = false; // Owner has exited; freed once drained
+  TraceEvent events[kRingCapacity];
+};
+
+struct TraceState {
+  std::mutex mutex; // Guards rings (registration) and the flusher lifecycle
+  std::vector<std::unique_ptr<ThreadRing>> rings;
+  unsigned nextThreadId = 1;
+  std::uint64_t retiredDropped = 0; // Drops counted by freed rings
+  std::FILE *file = nullptr;
+  bool firstEvent = true;
+  std::uint64_t baseUs = 0;
+  std::thread flusher;
+  std::condition_variable wake;
+  bool stopping = false;
+};
+
+TraceState &state() {
+  static TraceState s;
+  return s;
+}
+
+void release(TraceState &s, std::size_t index) {
+  s.retiredDropped += s.rings[index]->dropped.load(std::memory_order_relaxed);
+  s.rings[index] = std::move(s.rings.back());
+  s.rings.pop_back();
+}
+
+// Hands the ring back when its thread exits, so short-lived threads do not
+// each leave a full ring behind. Events still queued are written first.
+struct ThreadSlot {
+  ThreadRing *ring = nullptr;
+  ~ThreadSlot() {
+    if (ring == nullptr)
+      return;
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    ring->retired = true;
+    if (s.file != nullptr)
+      return; // The flusher frees it after the next drain
+    for (std::size_t i = 0; i < s.rings.size(); ++i)
+      if (s.rings[i].get() == ring) {
+        release(s, i);
+        break;
+      }
+  }
+};
+
+ThreadRing *threadRing() {
+  thread_local ThreadSlot slot;
+  if (slot.ring == nullptr) {
+    TraceState &s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.rings.emplace_back(new ThreadRing());
+    slot.ring = s.rings.back().get();
+    slot.ring->threadId = s.nextThreadId++;
+  }
+  return slot.ring;
+}
+
+void push(const TraceEvent &event) {
+  ThreadRing *ring = threadRing();
+  std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+  if (head - ring->tail.load(std::memory_order_acquire) >= kRingCapacity) {
+    ring->dropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring->events[head & (kRingCapacity - 1)] = event;
+  ring->head.store(head + 1, std::memory_order_release);
+}
+
+// Hand-rolled formatting: snprintf per event cost the flusher more CPU than
+// recording the event did.
+char *put(char *p, const char *text) {
+  while (*text != '\0')
+    *p++ = *text++;
+  return p;
+}
+
+char *putNumber(char *p, std::uint64_t value) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  while (n > 0)
+    *p++ = digits[--n];
+  return p;
+}
+
+// Longest event line without its name and category.
+const std::size_t kMaxEventChars = 160;
+
+// Formats everything currently in the rings into `out` and frees the rings of
+// threads that have exited. Called with s.mutex held.
+void drain(TraceState &s, std::string &out) {
+  char pid[24];
+  *putNumber(pid, (std::uint64_t)getpid()) = '\0';
+  for (std::size_t i = 0; i < s.rings.size();) {
+    ThreadRing *ring = s.rings[i].get();
+    std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    std::uint64_t head = ring->head.load(std::memory_order_acquire);
+    for (; tail != head; ++tail) {
+      const TraceEvent &e = ring->events[tail & (kRingCapacity - 1)];
+      std::uint64_t ts =
+          e.timestampUs > s.baseUs ? e.timestampUs - s.baseUs : 0;
+      std::size_t at = out.size();
+      out.resize(at + std::strlen(e.name) + std::strlen(e.category) +
+                 kMaxEventChars);
+      char *p = &out[at];
+      p = put(p, s.firstEvent ? "\n{\"name\":\"" : ",\n{\"name\":\"");
+      p = put(p, e.name);
+      p = put(p, "\",\"cat\":\"");
+      p = put(p, e.category);
+      if (e.phase == 'X') {
+        p = put(p, "\",\"ph\":\"X\",\"ts\":");
+        p = putNumber(p, ts);
+        p = put(p, ",\"dur\":");
+        p = putNumber(p, e.durationUs);
+      } else {
+        p = put(p, "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":");
+        p = putNumber(p, ts);
+      }
+      p = put(p, ",\"pid\":");
+      p = put(p, pid);
+      p = put(p, ",\"tid\":");
+      p = putNumber(p, ring->threadId);
+      *p++ = '}';
+      out.resize(p - out.data());
+      s.firstEvent = false;
+    }
+    ring->tail.store(tail, std::memory_order_release);
+    if (ring->retired)
+      release(s, i);
+    else
+      ++i;
+  }
+}
+
+// Only the flusher writes while it runs, and stop() joins it before closing
+// the file, so the write itself needs no lock; threads registering a ring
+// are not held up by the disk.
+void flushLoop() {
+  TraceState &s = state();
+  std::string out;
+  std::unique_lock<std::mutex> lock(s.mutex);
+  while (!s.stopping) {
+    s.wake.wait_for(lock, kFlushInterval);
+    drain(s, out);
+    if (out.empty())
+      continue;
+    lock.unlock();
+    std::fwrite(out.data(), 1, out.size(), s.file);
+    out.clear();
+    lock.lock();
+  }
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::active(false);
+
+bool Tracer::start(const std::string &path) {
+  TraceState &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  if (s.file != nullptr)
+    return false;
+  s.file = std::fopen(path.c_str(), "w");
+  if (s.file == nullptr)
+    return false;
+  std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", s.file);
+  s.firstEvent = true;
+  s.stopping = false;
+  s.baseUs = nowUs();
+  s.flusher = std::thread(flushLoop);
+  active.store(true, std::memory_order_release);
+  return true;
+}
+
+void Tracer::stop() {
+  TraceState &s = state();
+  if (!active.exchange(false))
+    return;
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stopping = true;
+  }
+  s.wake.notify_one();
+  s.flusher.join();
+
+  std::lock_guard<std::mutex> lock(s.mutex);
+  std::string out;
+  drain(s, out);
+  std::fwrite(out.data(), 1, out.size(), s.file);
+  std::fputs("\n]}\n", s.file);
+  std::fclose(s.file);
+  s.file = nullptr;
+}
+
+std::uint64_t Tracer::nowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Tracer::complete(const char *name, const char *category,
+                      std::uint64_t startUs, std::uint64_t durationUs) {
+  if (!enabled())
+    return;
+  push(TraceEvent{name, category, startUs, durationUs, 'X'});
+}
+
+void Tracer::instant(const char *name, const char *category) {
+  if (!enabled())
+    return;
+  push(TraceEvent{name, category, nowUs(), 0, 'i'});
+}
+
+std::uint64_t Tracer::droppedEvents() {
+  TraceState &s = state();
+  std::lock_guard<std::mutex> lock(s.mutex);
+  std::uint64_t total = s.retiredDropped;
+  for (auto &ring : s.rings)
+    total += ring->dropped.load(std::memory_order_relaxed);
+  return total;
+}
@@ -0,0 +1,54 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Opt-in recorder for Chrome/Perfetto trace-event JSON (load the output in
+// chrome://tracing or ui.perfetto.dev). Each thread appends to its own
+// preallocated ring buffer; a background thread drains the rings and streams
+// the events to disk. While tracing is off, recording is a single relaxed
+// atomic load.
+//
+// Event names and categories must be string literals (or otherwise outlive
+// the tracer): only the pointers are stored.
+class Tracer {
+public:
+  static bool start(const std::string &path);
+  static void stop();
+
+  static bool enabled() { return active.load(std::memory_order_relaxed); }
+  static std::uint64_t nowUs();
+
+  static void complete(const char *name, const char *category,
+                       std::uint64_t startUs, std::uint64_t durationUs);
+  static void instant(const char *name, const char *category);
+
+  // Events lost because a ring was full when the flusher fell behind.
+  static std::uint64_t droppedEvents();
+
+private:
+  static std::atomic<bool> active;
+};
+
+// Records the lifetime of the enclosing scope as one complete ("X") event.
+class TraceScope {
+public:
+  TraceScope(const char *name, const char *category)
+      : name(name), category(category),
+        startUs(Tracer::enabled() ? Tracer::nowUs() : 0) {}
+  ~TraceScope() {
+    if (startUs != 0 && Tracer::enabled())
+      Tracer::complete(name, category, startUs, Tracer::nowUs() - startUs);
+  }
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+  const char *name;
+  const char *category;
+  std::uint64_t startUs;
+};
+
+#endif // TRACER_H
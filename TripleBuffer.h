@@ -0,0 +1,43 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer. The producer fills
+// back() and publish()es it; the consumer's consume() hands out the newest
+// published value, skipping any it never got to see. Neither side ever waits
+// for the other.
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+  // Producer side
+  T &back() { return buffers[backIndex]; }
+  void publish() {
+    std::uint8_t old =
+        middle.exchange(backIndex | kFresh, std::memory_order_acq_rel);
+    backIndex = old & kIndexMask;
+  }
+
+  // Consumer side: the newest value, or nullptr if nothing new since the
+  // last call. The pointer stays valid until the next consume().
+  const T *consume() {
+    if ((middle.load(std::memory_order_relaxed) & kFresh) == 0)
+      return nullptr;
+    std::uint8_t old = middle.exchange(frontIndex, std::memory_order_acq_rel);
+    frontIndex = old & kIndexMask;
+    return &buffers[frontIndex];
+  }
+
+private:
+  static const std::uint8_t kIndexMask = 3;
+  static const std::uint8_t kFresh = 4;
+
+  T buffers[3];
+  std::atomic<std::uint8_t> middle; // Index of the shared slot | kFresh
+  std::uint8_t backIndex;           // Producer only
+  std::uint8_t frontIndex;          // Consumer only
+};
+
+#endif // TRIPLEBUFFER_H
@@ -1,26 +1,96 @@
 #include "UI.h"
+#include "Animation.h"
+#include "Scoreboard.h"
+#include <algorithm>
 #include <clocale>
-#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <cwchar>
+#include <mutex>
 #include <unistd.h>
 
-// Helper to calculate UTF-8 string length (number of characters, not bytes)
-size_t utf8_length(const std::string &str) {
-  size_t len = 0;
-  for (size_t i = 0; i < str.length(); ++i) {
-    if ((str[i] & 0xC0) != 0x80) {
-      len++;
+// Terminal columns taken by a UTF-8 string. Wide (CJK) characters take two,
+// so centring measures columns rather than characters. Falls back to one
+// column per character when the locale cannot decode the text.
+static size_t utf8_width(const char *str) {
+  size_t width = 0;
+  size_t left = std::strlen(str);
+  std::mbstate_t state{};
+  while (left > 0) {
+    wchar_t wc;
+    size_t n = std::mbrtowc(&wc, str, left, &state);
+    if (n == (size_t)-1 || n == (size_t)-2) {
+      state = std::mbstate_t{};
+      n = 1;
+      while (n < left && (str[n] & 0xC0) == 0x80)
+        n++;
+      width++;
+    } else {
+      int w = wcwidth(wc);
+      width += w > 0 ? w : 0;
     }
+    str += n;
+    left -= n;
   }
-  return len;
+  return width;
 }
 
-UI::UI() {}
+static size_t utf8_width(const std::string &str) {
+  return utf8_width(str.c_str());
+}
+
+// Rank, player, level, score and challenge columns of the leaderboard
+static const int kScoreboardTableWidth = 56;
+
+// Escape delay of kiosk seats, long enough for a sequence split over a slow
+// serial line.
+static const int kSeatEscDelayMs = 25;
+
+static const int kNumDifficulties = 5;
+static const char *const kDifficultyNames[kNumDifficulties] = {
+    "Easy", "Medium", "Hard", "Expert", "Master"};
+static const int kNumLanguages = 12;
+static const char *const kLanguages[kNumLanguages] = {
+    "English", "German",     "French",   "Spanish",
+    "Italian", "Portuguese", "Dutch",    "Ukrainian",
+    "Polish",  "Chinese",    "Japanese", "Korean"};
+
+UI::UI()
+    : layoutValid(false), screen(nullptr), menuChoice(0), settingsChoice(0),
+      settingsSource(0), animatedScreen(AnimatedScreen::NONE), screenScore(0),
+      screenLevel(0) {}
 
 UI::~UI() { cleanup(); }
 
 void UI::init() {
   setlocale(LC_ALL, ""); // Enable system locale for UTF-8 support
   initscr();
+  configureScreen();
+}
+
+bool UI::initHeadless(FILE *out, FILE *in) {
+  return initTerminal("xterm", out, in);
+}
+
+bool UI::initTerminal(const char *type, FILE *out, FILE *in) {
+  setlocale(LC_ALL, "");
+  screen = newterm(type, out, in);
+  if (screen == nullptr)
+    return false;
+  set_term(screen);
+  // A lone ESC makes ncurses wait this long for the rest of a key sequence;
+  // the default second would hold up every other seat in the kiosk loop.
+  set_escdelay(kSeatEscDelayMs);
+  configureScreen();
+  return true;
+}
+
+void UI::makeCurrent() {
+  if (screen != nullptr)
+    set_term(screen);
+}
+
+void UI::configureScreen() {
   cbreak();
   noecho();
   keypad(stdscr, TRUE);
@@ -35,23 +105,163 @@ void UI::init() {
 
 void UI::setNonBlocking(bool enable) { nodelay(stdscr, enable); }
 
-void UI::cleanup() { endwin(); }
+void UI::setInputTimeout(int ms) { timeout(ms); }
+
+void UI::cleanup() {
+  makeCurrent(); // endwin() acts on the current screen
+  endwin();
+  if (screen != nullptr) {
+    delscreen(screen);
+    screen = nullptr;
+  }
+}
 
 int UI::getScreenWidth() {
-  int w, h;
-  getmaxyx(stdscr, h, w);
-  (void)h; // Suppress unused warning
-  return w;
+  updateLayout();
+  return layout.width;
 }
 
 int UI::getScreenHeight() {
+  updateLayout();
+  return layout.height;
+}
+
+int UI::readKey() {
+  int ch = getch();
+  // ncurses turns SIGWINCH into KEY_RESIZE after resizing stdscr, so this is
+  // the only place the cached layout has to be thrown away.
+  if (ch == KEY_RESIZE)
+    invalidateLayout();
+  return ch;
+}
+
+void UI::invalidateLayout() { layoutValid = false; }
+
+void UI::updateLayout() {
+  if (layoutValid)
+    return;
+
   int w, h;
   getmaxyx(stdscr, h, w);
-  return h;
+  layout.width = w;
+  layout.height = h;
+
+  MainMenuLayout &menu = layout.mainMenu;
+  const char *menuKeys[] = {"start_game", "settings", "exit"};
+  menu.titleY = 5;
+  menu.titleX = centeredX(translate("title"));
+  for (int i = 0; i < 3; ++i) {
+    menu.optionY[i] = 10 + i * 2;
+    menu.optionX[i] = centeredX(translate(menuKeys[i]));
+  }
+
+  SettingsLayout &settings = layout.settings;
+  settings.titleY = 5;
+  settings.titleX = centeredX(translate("settings"));
+  for (int i = 0; i < 3; ++i)
+    settings.rowY[i] = 10 + i * 2;
+  settings.backX = centeredX(translate("back"));
+
+  // Narrow UI Logic
+  GameLayout &game = layout.game;
+  game.gameWidth = 80;
+  if (w < 80)
+    game.gameWidth = w;
+  game.startX = (w - game.gameWidth) / 2;
+  game.hudY = 1;
+  game.scoreX = game.startX + 2;
+  game.levelRightX = game.startX + game.gameWidth - 2;
+  game.barY = 2;
+  game.barX = game.startX + 2;
+  game.barWidth = game.gameWidth - 4;
+  game.barEndX = game.startX + game.gameWidth - 2;
+  game.problemY = 5;
+  game.optionsY = 10;
+  int laneWidth = game.gameWidth / 3;
+  game.laneX[0] = game.startX + laneWidth / 2;
+  game.laneX[1] = game.startX + game.gameWidth / 2;
+  game.laneX[2] = game.startX + game.gameWidth - laneWidth / 2;
+  game.arrowY = 12;
+
+  GameOverLayout &over = layout.gameOver;
+  over.titleY = 5;
+  over.titleX = centeredX(translate("game_over"));
+  over.scoreY = 7;
+  over.levelY = 8;
+  over.promptY = 20;
+  over.promptX = centeredX(translate("press_space"));
+  over.spriteX = w / 2 - 10;
+  over.spriteY = 12;
+
+  LevelCompleteLayout &complete = layout.levelComplete;
+  complete.titleY = h / 2 - 5;
+  complete.promptY = h / 2 + 5;
+  complete.promptX = centeredX(translate("press_space"));
+  complete.catY = h / 2;
+
+  ScoreboardLayout &board = layout.scoreboard;
+  board.titleY = 2;
+  board.titleX = centeredX(translate("leaderboard"));
+  board.headerY = 4;
+  board.firstRowY = 6;
+  board.promptY = h - 2;
+  board.promptX = centeredX(translate("press_q"));
+  board.maxRows = board.promptY - 1 - board.firstRowY;
+  if (board.maxRows < 0)
+    board.maxRows = 0;
+  board.tableX = (w - kScoreboardTableWidth) / 2;
+  if (board.tableX < 0)
+    board.tableX = 0;
+
+  layoutValid = true;
+}
+
+std::shared_ptr<const UI::Translations>
+UI::sharedTranslations(const std::string &code) {
+  static std::mutex mutex;
+  static std::map<std::string, std::shared_ptr<const Translations>> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_ptr<const Translations> &cached = cache[code];
+  if (cached)
+    return cached;
+
+  auto table = std::make_shared<Translations>();
+  std::string filename = "lang/" + code + ".json";
+  std::ifstream file(filename);
+  if (file.is_open()) {
+    std::string line;
+    while (std::getline(file, line)) {
+      // Simple JSON extraction: "key": "value"
+      size_t colonPos = line.find(':');
+      if (colonPos != std::string::npos) {
+        size_t keyStart = line.find('"');
+        size_t keyEnd = line.find('"', keyStart + 1);
+        size_t valStart = line.find('"', colonPos + 1);
+        size_t valEnd = line.find('"', valStart + 1);
+
+        if (keyStart != std::string::npos && keyEnd != std::string::npos &&
+            valStart != std::string::npos && valEnd != std::string::npos) {
+          std::string key = line.substr(keyStart + 1, keyEnd - keyStart - 1);
+          std::string value = line.substr(valStart + 1, valEnd - valStart - 1);
+          (*table)[key] = value;
+        }
+      }
+    }
+    file.close();
+  }
+  cached = table;
+  return cached;
+}
+
+bool UI::isLanguage(const std::string &lang) {
+  for (const char *name : kLanguages)
+    if (lang == name)
+      return true;
+  return false;
 }
 
 void UI::loadLanguage(std::string lang) {
-  translations.clear();
+  invalidateLayout(); // Label widths differ between languages
 
   // Map full name to ISO code
   std::string code = "en";
@@ -80,275 +290,261 @@ void UI::loadLanguage(std::string lang) {
   else if (lang == "Korean")
     code = "ko";
 
-  std::string filename = "lang/" + code + ".json";
-  std::ifstream file(filename);
-  if (file.is_open()) {
-    std::string line;
-    while (std::getline(file, line)) {
-      // Simple JSON extraction: "key": "value"
-      size_t colonPos = line.find(':');
-      if (colonPos != std::string::npos) {
-        size_t keyStart = line.find('"');
-        size_t keyEnd = line.find('"', keyStart + 1);
-        size_t valStart = line.find('"', colonPos + 1);
-        size_t valEnd = line.find('"', valStart + 1);
-
-        if (keyStart != std::string::npos && keyEnd != std::string::npos &&
-            valStart != std::string::npos && valEnd != std::string::npos) {
-          std::string key = line.substr(keyStart + 1, keyEnd - keyStart - 1);
-          std::string value = line.substr(valStart + 1, valEnd - valStart - 1);
-          translations[key] = value;
-        }
-      }
-    }
-    file.close();
-  }
+  translations = sharedTranslations(code);
+  scoreLabel = translate("score");
+  levelLabel = translate("level");
+  problemLabel = translate("problem");
 }
 
-std::string UI::translate(std::string key) {
-  if (translations.find(key) != translations.end()) {
-    return translations[key];
+std::string UI::translate(const std::string &key) const {
+  if (translations) {
+    auto it = translations->find(key);
+    if (it != translations->end())
+      return it->second;
   }
   return key; // Fallback to key
 }
 
+int UI::centeredX(const std::string &text) {
+  return (layout.width - (int)utf8_width(text)) / 2;
+}
+
 void UI::drawCentered(int y, std::string text) {
-  int w = getScreenWidth();
-  mvprintw(y, (w - utf8_length(text)) / 2, "%s", text.c_str());
+  updateLayout();
+  mvprintw(y, centeredX(text), "%s", text.c_str());
 }
 
-void UI::drawCenteredX(int y, int x, int w, std::string text) {
-  mvprintw(y, x + (w - utf8_length(text)) / 2, "%s", text.c_str());
+void UI::drawCenteredX(int y, int x, int w, const char *text) {
+  mvprintw(y, x + (w - (int)utf8_width(text)) / 2, "%s", text);
 }
 
 MenuOption UI::showMainMenu() {
   nodelay(stdscr, FALSE); // Blocking for menu
-  int choice = 0;
-  const int numOptions = 3;
-  // Dynamic options based on translation
-
-  while (true) {
-    clear();
-    drawCentered(5, translate("title"));
-
-    std::string options[] = {translate("start_game"), translate("settings"),
-                             translate("exit")};
-
-    for (int i = 0; i < numOptions; ++i) {
-      if (i == choice)
-        attron(A_REVERSE);
-      drawCentered(10 + i * 2, options[i]);
-      if (i == choice)
-        attroff(A_REVERSE);
-    }
-
-    int ch = getch();
-    switch (ch) {
-    case KEY_UP:
-      choice = (choice - 1 + numOptions) % numOptions;
-      break;
-    case KEY_DOWN:
-      choice = (choice + 1) % numOptions;
-      break;
-    case 10: // Enter
-      return static_cast<MenuOption>(choice);
-    }
+  beginMainMenu();
+  MenuOption picked;
+  while (!mainMenuKey(readKey(), picked)) {
   }
+  return picked;
 }
 
-void UI::showSettings(Difficulty &currentDiff, std::string &currentLang) {
-  nodelay(stdscr, FALSE);
-  int choice = 0;
-  const int numOptions = 3; // Diff, Lang, Back
-
-  std::string diffNames[] = {"Easy", "Medium", "Hard", "Expert", "Master"};
-  std::string languages[] = {"English", "German",     "French",   "Spanish",
-                             "Italian", "Portuguese", "Dutch",    "Ukrainian",
-                             "Polish",  "Chinese",    "Japanese", "Korean"};
-  // int langIndex = 0; // Simplified for now, just cycling
-
-  while (true) {
-    clear();
-    drawCentered(5, translate("settings"));
+void UI::beginMainMenu() {
+  menuChoice = 0;
+  drawMainMenu();
+}
 
-    std::string diffStr =
-        translate("difficulty") + ": " + diffNames[(int)currentDiff];
-    std::string langStr = translate("language") + ": " + currentLang;
-    std::string backStr = translate("back");
+void UI::drawMainMenu() {
+  updateLayout();
+  const MainMenuLayout &menu = layout.mainMenu;
+  clear();
+  mvprintw(menu.titleY, menu.titleX, "%s", translate("title").c_str());
 
-    if (choice == 0)
-      attron(A_REVERSE);
-    drawCentered(10, diffStr);
-    if (choice == 0)
-      attroff(A_REVERSE);
+  // Dynamic options based on translation
+  std::string options[] = {translate("start_game"), translate("settings"),
+                           translate("exit")};
 
-    if (choice == 1)
+  for (int i = 0; i < 3; ++i) {
+    if (i == menuChoice)
       attron(A_REVERSE);
-    drawCentered(12, langStr);
-    if (choice == 1)
+    mvprintw(menu.optionY[i], menu.optionX[i], "%s", options[i].c_str());
+    if (i == menuChoice)
       attroff(A_REVERSE);
+  }
+}
 
-    if (choice == 2)
-      attron(A_REVERSE);
-    drawCentered(14, backStr);
-    if (choice == 2)
-      attroff(A_REVERSE);
+bool UI::mainMenuKey(int ch, MenuOption &picked) {
+  const int numOptions = 3;
+  switch (ch) {
+  case KEY_UP:
+    menuChoice = (menuChoice - 1 + numOptions) % numOptions;
+    break;
+  case KEY_DOWN:
+    menuChoice = (menuChoice + 1) % numOptions;
+    break;
+  case 10: // Enter
+    picked = static_cast<MenuOption>(menuChoice);
+    return true;
+  }
+  drawMainMenu();
+  return false;
+}
 
-    int ch = getch();
-    switch (ch) {
-    case KEY_UP:
-      choice = (choice - 1 + numOptions) % numOptions;
-      break;
-    case KEY_DOWN:
-      choice = (choice + 1) % numOptions;
-      break;
-    case KEY_LEFT:
-      if (choice == 0) {
-        int d = (int)currentDiff - 1;
-        if (d < 0)
-          d = 4;
-        currentDiff = (Difficulty)d;
-      } else if (choice == 1) {
-        // Cycle languages backwards
-        int numLangs = 12;
-        int currentLangIdx = 0;
-        for (int i = 0; i < numLangs; ++i)
-          if (languages[i] == currentLang)
-            currentLangIdx = i;
-        currentLangIdx = (currentLangIdx - 1 + numLangs) % numLangs;
-        currentLang = languages[currentLangIdx];
-        loadLanguage(currentLang); // Reload immediately
-      }
-      break;
-    case KEY_RIGHT:
-      if (choice == 0) {
-        int d = (int)currentDiff + 1;
-        if (d > 4)
-          d = 0;
-        currentDiff = (Difficulty)d;
-      } else if (choice == 1) {
-        // Cycle languages
-        int numLangs = 12;
-        int currentLangIdx = 0;
-        for (int i = 0; i < numLangs; ++i)
-          if (languages[i] == currentLang)
-            currentLangIdx = i;
-        currentLangIdx = (currentLangIdx + 1) % numLangs;
-        currentLang = languages[currentLangIdx];
-        loadLanguage(currentLang); // Reload immediately
-      }
-      break;
-    case 10: // Enter
-      if (choice == 2)
-        return;
-      break;
-    }
+void UI::showSettings(Difficulty &currentDiff, std::string &currentLang,
+                      const std::vector<std::string> &banks,
+                      std::string &currentBank) {
+  nodelay(stdscr, FALSE);
+  beginSettings(currentDiff, currentLang, banks, currentBank);
+  while (!settingsKey(readKey(), currentDiff, currentLang, currentBank)) {
   }
 }
 
-void UI::showGameOver(int score, int level) {
-  nodelay(stdscr, TRUE); // Non-blocking for animation
+void UI::beginSettings(Difficulty currentDiff, const std::string &currentLang,
+                       const std::vector<std::string> &banks,
+                       const std::string &currentBank) {
+  settingsChoice = 0;
+  settingsBanks = banks;
+  // The difficulty row cycles through the five Difficulty values, then banks.
+  settingsSource = (int)currentDiff;
+  for (int i = 0; i < (int)banks.size(); ++i)
+    if (banks[i] == currentBank)
+      settingsSource = kNumDifficulties + i;
+  drawSettings(currentLang);
+}
 
-  // Crying Dolphin ASCII
-  std::string dolphin = "          ,\n"
-                        "      __)\\_  \n"
-                        "(\\_.-'    a`-.\n"
-                        "(/~~````(/~^^`";
+void UI::drawSettings(const std::string &currentLang) {
+  updateLayout();
+  const SettingsLayout &settings = layout.settings;
+  clear();
+  mvprintw(settings.titleY, settings.titleX, "%s",
+           translate("settings").c_str());
+
+  std::string diffStr =
+      translate("difficulty") + ": " +
+      (settingsSource < kNumDifficulties
+           ? std::string(kDifficultyNames[settingsSource])
+           : settingsBanks[settingsSource - kNumDifficulties]);
+  std::string langStr = translate("language") + ": " + currentLang;
+  std::string backStr = translate("back");
+
+  if (settingsChoice == 0)
+    attron(A_REVERSE);
+  drawCentered(settings.rowY[0], diffStr);
+  if (settingsChoice == 0)
+    attroff(A_REVERSE);
+
+  if (settingsChoice == 1)
+    attron(A_REVERSE);
+  drawCentered(settings.rowY[1], langStr);
+  if (settingsChoice == 1)
+    attroff(A_REVERSE);
+
+  if (settingsChoice == 2)
+    attron(A_REVERSE);
+  mvprintw(settings.rowY[2], settings.backX, "%s", backStr.c_str());
+  if (settingsChoice == 2)
+    attroff(A_REVERSE);
+}
 
-  int frame = 0;
-  while (true) {
-    clear();
-    attron(COLOR_PAIR(3));
-    drawCentered(5, translate("game_over"));
-    attroff(COLOR_PAIR(3));
-    drawCentered(7, translate("score") + ": " + std::to_string(score));
-    drawCentered(8, translate("level") + ": " + std::to_string(level));
-    drawCentered(20, translate("press_space"));
-
-    // Draw dolphin
-    int dX = getScreenWidth() / 2 - 10;
-    int dY = 12;
-    int curY = dY;
-    std::stringstream ss(dolphin);
-    std::string line;
-    while (std::getline(ss, line)) {
-      mvprintw(curY++, dX, "%s", line.c_str());
+bool UI::settingsKey(int ch, Difficulty &currentDiff, std::string &currentLang,
+                     std::string &currentBank) {
+  const int numOptions = 3; // Diff, Lang, Back
+  const int numSources = kNumDifficulties + (int)settingsBanks.size();
+  int step = 0;
+  switch (ch) {
+  case KEY_UP:
+    settingsChoice = (settingsChoice - 1 + numOptions) % numOptions;
+    break;
+  case KEY_DOWN:
+    settingsChoice = (settingsChoice + 1) % numOptions;
+    break;
+  case KEY_LEFT:
+    step = -1;
+    break;
+  case KEY_RIGHT:
+    step = 1;
+    break;
+  case 10: // Enter
+    if (settingsChoice == 2) {
+      if (settingsSource < kNumDifficulties) {
+        currentDiff = (Difficulty)settingsSource;
+        currentBank.clear();
+      } else {
+        currentBank = settingsBanks[settingsSource - kNumDifficulties];
+      }
+      return true;
     }
+    break;
+  }
 
-    // Animate tears
-    if (frame % 4 == 0)
-      mvprintw(dY + 2, dX + 12, ".");
-    if (frame % 4 == 1)
-      mvprintw(dY + 3, dX + 12, "o");
-    if (frame % 4 == 2)
-      mvprintw(dY + 4, dX + 12, "O");
-    if (frame % 4 == 3)
-      mvprintw(dY + 5, dX + 12, ".");
-
-    refresh();
-    usleep(200000);
-    frame++;
-
-    int ch = getch();
-    if (ch == ' ') {
-      nodelay(stdscr, FALSE);
-      return;
-    }
-    if (ch == 'q' || ch == 'Q') {
-      nodelay(stdscr, FALSE);
-      return;
-    }
+  if (step != 0 && settingsChoice == 0) {
+    settingsSource = (settingsSource + step + numSources) % numSources;
+  } else if (step != 0 && settingsChoice == 1) {
+    // Cycle languages
+    int currentLangIdx = 0;
+    for (int i = 0; i < kNumLanguages; ++i)
+      if (kLanguages[i] == currentLang)
+        currentLangIdx = i;
+    currentLangIdx = (currentLangIdx + step + kNumLanguages) % kNumLanguages;
+    currentLang = kLanguages[currentLangIdx];
+    loadLanguage(currentLang); // Reload immediately
   }
+  drawSettings(currentLang);
+  return false;
 }
 
-void UI::showLevelComplete(int level) {
-  // Moving Cat Animation
-  std::string cat1 =
-      "      |\\      _,,,---,,_\nZZZzz /,`.-'`'    -.  ;-;;,_\n     |,4-  ) "
-      ")-,_. ,\\ (  `'-'\n    '---''(_/--'  `-'\\_)";
-  // Simple cat ASCII
+void UI::beginGameOver(int score, int level) {
+  animatedScreen = AnimatedScreen::GAME_OVER;
+  screenScore = score;
+  screenLevel = level;
+  drawAnimatedScreen();
+}
 
-  int w = getScreenWidth();
-  int h = getScreenHeight();
-  int catY = h / 2;
+void UI::beginLevelComplete(int level) {
+  animatedScreen = AnimatedScreen::LEVEL_COMPLETE;
+  screenLevel = level;
+  drawAnimatedScreen();
+}
 
-  nodelay(stdscr, TRUE); // Non-blocking to allow animation loop
+bool UI::inAnimatedScreen() const {
+  return animatedScreen != AnimatedScreen::NONE;
+}
 
-  for (int x = -20; x < w; x += 2) {
-    clear();
-    drawCentered(h / 2 - 5, translate("level") + " " + std::to_string(level) +
-                                " " + "Completed!");
-    drawCentered(h / 2 + 5, translate("press_space"));
+void UI::drawAnimatedScreen() {
+  updateLayout();
+  clear();
+  if (animatedScreen == AnimatedScreen::GAME_OVER) {
+    const GameOverLayout &over = layout.gameOver;
+    attron(COLOR_PAIR(3));
+    mvprintw(over.titleY, over.titleX, "%s", translate("game_over").c_str());
+    attroff(COLOR_PAIR(3));
+    drawCentered(over.scoreY,
+                 translate("score") + ": " + std::to_string(screenScore));
+    drawCentered(over.levelY,
+                 translate("level") + ": " + std::to_string(screenLevel));
+    mvprintw(over.promptY, over.promptX, "%s",
+             translate("press_space").c_str());
+
+    const Sprite &dolphin = dolphinSprite();
+    for (int row = 0; row < dolphin.height; ++row)
+      mvprintw(over.spriteY + row, over.spriteX, "%s",
+               dolphin.lines[row].c_str());
+    animation.reset(new TearsAnimation(over.spriteX, over.spriteY));
+  } else if (animatedScreen == AnimatedScreen::LEVEL_COMPLETE) {
+    const LevelCompleteLayout &complete = layout.levelComplete;
+    drawCentered(complete.titleY, translate("level") + " " +
+                                      std::to_string(screenLevel) + " " +
+                                      "Completed!");
+    mvprintw(complete.promptY, complete.promptX, "%s",
+             translate("press_space").c_str());
+    // After a resize the cat starts over instead of jumping to a stale spot.
+    animation.reset(new WalkingCatAnimation(complete.catY, layout.width));
+  }
+  if (animation)
+    animation->start(Animation::nowMs());
+  refresh();
+}
 
-    // Draw cat at x
-    int curY = catY;
-    std::string line;
-    std::stringstream ss(cat1);
-    while (std::getline(ss, line)) {
-      if (x >= 0 && x < w)
-        mvprintw(curY++, x, "%s", line.c_str());
-      else
-        curY++;
-    }
+int UI::pollAnimatedScreen() {
+  // Sleep until the next frame is due, but wake up on the first key press.
+  int wait = animation ? animation->msUntilDue(Animation::nowMs()) : -1;
+  timeout(wait);
+  int ch = readKey();
+  timeout(0);
+
+  if (ch == KEY_RESIZE)
+    drawAnimatedScreen();
+  else
+    stepAnimation();
+  return ch;
+}
 
+void UI::stepAnimation() {
+  if (animation && animation->update(Animation::nowMs()))
     refresh();
-    usleep(100000); // 100ms
-
-    // Check for space
-    int ch = getch();
-    if (ch == ' ') {
-      nodelay(stdscr, FALSE); // Restore blocking
-      return;
-    }
-  }
+}
 
-  // If animation finishes, wait for space
-  nodelay(stdscr, FALSE);
-  while (true) {
-    int ch = getch();
-    if (ch == ' ')
-      return;
-  }
+void UI::endAnimatedScreen() {
+  animatedScreen = AnimatedScreen::NONE;
+  animation.reset();
 }
 
 void UI::showLevelUp(int level) {
@@ -367,45 +563,87 @@ void UI::showLevelUp(int level) {
   }
 }
 
+void UI::showScoreboard(const Scoreboard &board) {
+  nodelay(stdscr, TRUE);
+  ScoreEntry entries[Scoreboard::kMaxSessions];
+
+  while (true) {
+    int ch = readKey();
+    if (ch == 'q' || ch == 'Q') {
+      nodelay(stdscr, FALSE);
+      return;
+    }
+
+    int count = board.snapshot(entries, Scoreboard::kMaxSessions);
+    std::sort(entries, entries + count,
+              [](const ScoreEntry &a, const ScoreEntry &b) {
+                if (a.score != b.score)
+                  return a.score > b.score;
+                return a.challengesPassed > b.challengesPassed;
+              });
+
+    updateLayout();
+    const ScoreboardLayout &l = layout.scoreboard;
+    erase();
+    attron(COLOR_PAIR(4));
+    mvprintw(l.titleY, l.titleX, "%s", translate("leaderboard").c_str());
+    attroff(COLOR_PAIR(4));
+
+    attron(A_BOLD);
+    mvprintw(l.headerY, l.tableX, "  #");
+    mvprintw(l.headerY, l.tableX + 5, "%s", translate("player").c_str());
+    mvprintw(l.headerY, l.tableX + 23, "%s", translate("level").c_str());
+    mvprintw(l.headerY, l.tableX + 33, "%s", translate("score").c_str());
+    mvprintw(l.headerY, l.tableX + 43, "%s", translate("challenges").c_str());
+    attroff(A_BOLD);
+
+    for (int i = 0; i < count && i < l.maxRows; ++i) {
+      const ScoreEntry &e = entries[i];
+      mvprintw(l.firstRowY + i, l.tableX, "%3d  %-16s  %6d  %8d  %10d", i + 1,
+               e.player, e.level, e.score, e.challengesPassed);
+    }
+
+    mvprintw(l.promptY, l.promptX, "%s", translate("press_q").c_str());
+    refresh();
+    napms(50); // 20 refreshes per second
+  }
+}
+
 void UI::drawGame(int score, int level, int challengesPassed,
-                  const MathProblem &problem, float timeLeft, int width,
-                  int height) {
-  (void)height;
+                  const ProblemView &problem, float timeLeft) {
+  updateLayout();
+  const GameLayout &g = layout.game;
   clear();
 
-  // Narrow UI Logic
-  int gameWidth = 80;
-  if (width < 80)
-    gameWidth = width;
-  int startX = (width - gameWidth) / 2;
-
-  // HUD
-  std::string scoreStr = translate("score") + ": " + std::to_string(score);
-  std::string levelStr = translate("level") + ": " + std::to_string(level);
-  std::string challengeStr =
-      "Challenge: " + std::to_string((challengesPassed % 10) + 1) + "/10";
+  // HUD. Formatted into stack buffers: this runs every frame and must not
+  // allocate.
+  char levelStr[128];
+  char challengeStr[32];
+  std::snprintf(levelStr, sizeof(levelStr), "%s: %d", levelLabel.c_str(),
+                level);
+  std::snprintf(challengeStr, sizeof(challengeStr), "Challenge: %d/10",
+                (challengesPassed % 10) + 1);
 
-  mvprintw(1, startX + 2, "%s", scoreStr.c_str());
+  mvprintw(g.hudY, g.scoreX, "%s: %d", scoreLabel.c_str(), score);
 
-  int levelLen = utf8_length(levelStr);
-  int levelX = startX + gameWidth - 2 - levelLen;
-  if (levelX < startX + 2)
-    levelX = startX + 2; // Safety clamp
-  mvprintw(1, levelX, "%s", levelStr.c_str());
+  int levelLen = utf8_width(levelStr);
+  int levelX = g.levelRightX - levelLen;
+  if (levelX < g.scoreX)
+    levelX = g.scoreX; // Safety clamp
+  mvprintw(g.hudY, levelX, "%s", levelStr);
 
   // Draw challenge counter centered
-  drawCenteredX(1, startX, gameWidth, challengeStr);
+  drawCenteredX(g.hudY, g.startX, g.gameWidth, challengeStr);
 
   // Progress Bar
-  int barWidth = gameWidth - 4;
-  int filledWidth = (int)(barWidth * timeLeft);
+  int filledWidth = (int)(g.barWidth * timeLeft);
 
-  mvprintw(2, startX + 2, "[");
+  mvprintw(g.barY, g.barX, "[");
   attron(COLOR_PAIR(2));
   if (timeLeft < 0.3f)
     attron(COLOR_PAIR(3));
 
-  for (int i = 0; i < barWidth; ++i) {
+  for (int i = 0; i < g.barWidth; ++i) {
     if (i < filledWidth)
       addch('=');
     else
@@ -413,37 +651,30 @@ void UI::drawGame(int score, int level, int challengesPassed,
   }
   attroff(COLOR_PAIR(2));
   attroff(COLOR_PAIR(3));
-  mvprintw(2, startX + gameWidth - 2, "]");
+  mvprintw(g.barY, g.barEndX, "]");
 
   // Problem
-  drawCenteredX(5, startX, gameWidth,
-                translate("problem") + ": " + problem.question);
-
-  // Lanes
-  int laneWidth = gameWidth / 3;
-  int lane1X = startX + laneWidth / 2;
-  int lane2X = startX + gameWidth / 2;
-  int lane3X = startX + gameWidth - laneWidth / 2;
+  char problemStr[256];
+  std::snprintf(problemStr, sizeof(problemStr), "%s: %.*s",
+                problemLabel.c_str(), (int)problem.question.size(),
+                problem.question.data());
+  drawCenteredX(g.problemY, g.startX, g.gameWidth, problemStr);
 
   // Draw Options
-  mvprintw(10, lane1X - 2, "%d", problem.options[0]); // Left
-  mvprintw(10, lane2X - 2, "%d", problem.options[1]); // Up (Middle)
-  mvprintw(10, lane3X - 2, "%d", problem.options[2]); // Right
+  mvprintw(g.optionsY, g.laneX[0] - 2, "%d", problem.options[0]); // Left
+  mvprintw(g.optionsY, g.laneX[1] - 2, "%d", problem.options[1]); // Up
+  mvprintw(g.optionsY, g.laneX[2] - 2, "%d", problem.options[2]); // Right
 
   // Draw arrows
-  mvprintw(12, lane1X - 2, "^");
-  mvprintw(13, lane1X - 2, "|");
-  mvprintw(14, lane1X - 4, "LEFT");
-
-  mvprintw(12, lane2X - 2, "^");
-  mvprintw(13, lane2X - 2, "|");
-  mvprintw(14, lane2X - 3, "UP");
-
-  mvprintw(12, lane3X - 2, "^");
-  mvprintw(13, lane3X - 2, "|");
-  mvprintw(14, lane3X - 4, "RIGHT");
-
-  refresh();
+  const char *arrowLabels[] = {"LEFT", "UP", "RIGHT"};
+  const int labelOffsets[] = {4, 3, 4};
+  for (int i = 0; i < 3; ++i) {
+    mvprintw(g.arrowY, g.laneX[i] - 2, "^");
+    mvprintw(g.arrowY + 1, g.laneX[i] - 2, "|");
+    mvprintw(g.arrowY + 2, g.laneX[i] - labelOffsets[i], "%s", arrowLabels[i]);
+  }
 }
 
-int UI::getInput() { return getch(); }
+void UI::present() { refresh(); }
+
+int UI::getInput() { return readKey(); }
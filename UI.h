@@ -1,13 +1,18 @@
 #ifndef UI_H
 #define UI_H
 
+#include "Layout.h"
 #include "MathGenerator.h"
 #include <fstream>
 #include <map>
+#include <memory>
 #include <ncurses.h>
 #include <string>
 #include <vector>
 
+class Animation;
+class Scoreboard;
+
 enum class MenuOption { START_GAME, SETTINGS, EXIT };
 
 class UI {
@@ -16,33 +21,98 @@ public:
   ~UI();
 
   void init();
+  // Runs the UI on an explicit terminal instead of the controlling one, e.g.
+  // /dev/null for headless benchmarks.
+  bool initHeadless(FILE *out, FILE *in);
+  // Same for a terminal of terminfo `type`. Several UIs can run this way in
+  // one process; makeCurrent() switches ncurses to this one.
+  bool initTerminal(const char *type, FILE *out, FILE *in);
+  void makeCurrent();
   void cleanup();
   void setNonBlocking(bool enable);
+  void setInputTimeout(int ms); // getInput() waits at most this long
   void loadLanguage(std::string lang);
+  static bool isLanguage(const std::string &lang); // "English", "German", ...
 
   // Menu
   MenuOption showMainMenu();
-  void showSettings(Difficulty &currentDiff, std::string &currentLang);
-  void showGameOver(int score, int level);
-  void showLevelComplete(int level);
+  // The difficulty row also offers the curated problem `banks`; picking one
+  // sets `currentBank`, picking a Difficulty clears it.
+  void showSettings(Difficulty &currentDiff, std::string &currentLang,
+                    const std::vector<std::string> &banks,
+                    std::string &currentBank);
+  // The same menus a key at a time, for callers that must not block: begin*
+  // draws the menu and *Key() handles one key, redrawing it, until it returns
+  // true. The show* calls above run these to completion.
+  void beginMainMenu();
+  bool mainMenuKey(int ch, MenuOption &picked);
+  void beginSettings(Difficulty currentDiff, const std::string &currentLang,
+                     const std::vector<std::string> &banks,
+                     const std::string &currentBank);
+  bool settingsKey(int ch, Difficulty &currentDiff, std::string &currentLang,
+                   std::string &currentBank);
+
   void showLevelUp(int level);
+  void showScoreboard(const Scoreboard &board); // Live view until Q
+
+  // Animated screens. begin* draws the screen once; pollAnimatedScreen()
+  // then waits for a key or the next animation frame, whichever comes first,
+  // repaints only what moved and returns the key (ERR if none).
+  void beginGameOver(int score, int level);
+  void beginLevelComplete(int level);
+  int pollAnimatedScreen();
+  void stepAnimation(); // Draws the next frame if it is due; does not wait
+  void endAnimatedScreen();
+  bool inAnimatedScreen() const;
 
   // Game
   void drawGame(int score, int level, int challengesPassed,
-                const MathProblem &problem, float timeLeft, int width,
-                int height);
-  int getInput(); // Returns key press
+                const ProblemView &problem, float timeLeft);
+  void present(); // Pushes the drawn frame to the terminal
+  int getInput(); // Returns key press, handling KEY_RESIZE internally
 
   int getScreenWidth();
   int getScreenHeight();
 
 private:
+  void configureScreen();
+  void drawMainMenu();
+  void drawSettings(const std::string &currentLang);
+  void drawAnimatedScreen();
   void drawBorders();
+  int readKey();
+  void invalidateLayout();
+  void updateLayout();
+  int centeredX(const std::string &text);
   void drawCentered(int y, std::string text);
-  void drawCenteredX(int y, int x, int w, std::string text);
-  std::string translate(std::string key);
+  void drawCenteredX(int y, int x, int w, const char *text);
+  std::string translate(const std::string &key) const;
+
+  // Parsed once per process and shared by every UI showing that language.
+  typedef std::map<std::string, std::string> Translations;
+  static std::shared_ptr<const Translations> sharedTranslations(
+      const std::string &code);
+
+  std::shared_ptr<const Translations> translations;
+  // HUD labels, looked up once per language so drawGame() does no lookups
+  std::string scoreLabel;
+  std::string levelLabel;
+  std::string problemLabel;
+
+  ScreenLayout layout;
+  bool layoutValid;
+  SCREEN *screen; // Only set when created through initTerminal()
+
+  int menuChoice;
+  int settingsChoice;
+  int settingsSource; // A Difficulty, then the banks after the five of them
+  std::vector<std::string> settingsBanks;
 
-  std::map<std::string, std::string> translations;
+  enum class AnimatedScreen { NONE, GAME_OVER, LEVEL_COMPLETE };
+  AnimatedScreen animatedScreen;
+  int screenScore;
+  int screenLevel;
+  std::unique_ptr<Animation> animation;
 };
 
 #endif // UI_H
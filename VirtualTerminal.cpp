@@ -0,0 +1,374 @@
+#include "VirtualTerminal.h"
+#include <algorithm>
+#include <cstdlib>
+
+VirtualTerminal::VirtualTerminal(int width, int height)
+    : cols(width), rows(height), cells((std::size_t)width * height, U' '),
+      x(0), y(0), wrapPending(false), savedX(0), savedY(0), scrollTop(0),
+      scrollBottom(height - 1), lastPrinted(U' '), state(State::GROUND),
+      utf8Char(0), utf8Remaining(0), unknown(0) {}
+
+// East Asian wide and fullwidth ranges; enough for the languages we ship.
+int VirtualTerminal::charWidth(char32_t c) {
+  if ((c >= 0x1100 && c <= 0x115F) || (c >= 0x2E80 && c <= 0x303E) ||
+      (c >= 0x3041 && c <= 0x33FF) || (c >= 0x3400 && c <= 0x4DBF) ||
+      (c >= 0x4E00 && c <= 0x9FFF) || (c >= 0xA000 && c <= 0xA4CF) ||
+      (c >= 0xAC00 && c <= 0xD7A3) || (c >= 0xF900 && c <= 0xFAFF) ||
+      (c >= 0xFE30 && c <= 0xFE4F) || (c >= 0xFF00 && c <= 0xFF60) ||
+      (c >= 0xFFE0 && c <= 0xFFE6) || (c >= 0x20000 && c <= 0x3FFFD))
+    return 2;
+  return 1;
+}
+
+char32_t &VirtualTerminal::cell(int column, int row) {
+  return cells[(std::size_t)row * cols + column];
+}
+
+char32_t VirtualTerminal::at(int column, int row) const {
+  return cells[(std::size_t)row * cols + column];
+}
+
+std::string VirtualTerminal::row(int index) const {
+  std::string out;
+  for (int c = 0; c < cols; ++c) {
+    char32_t ch = at(c, index);
+    if (ch == 0)
+      continue; // Right half of a wide character
+    if (ch < 0x80) {
+      out += (char)ch;
+    } else if (ch < 0x800) {
+      out += (char)(0xC0 | (ch >> 6));
+      out += (char)(0x80 | (ch & 0x3F));
+    } else if (ch < 0x10000) {
+      out += (char)(0xE0 | (ch >> 12));
+      out += (char)(0x80 | ((ch >> 6) & 0x3F));
+      out += (char)(0x80 | (ch & 0x3F));
+    } else {
+      out += (char)(0xF0 | (ch >> 18));
+      out += (char)(0x80 | ((ch >> 12) & 0x3F));
+      out += (char)(0x80 | ((ch >> 6) & 0x3F));
+      out += (char)(0x80 | (ch & 0x3F));
+    }
+  }
+  out.erase(out.find_last_not_of(' ') + 1);
+  return out;
+}
+
+std::string VirtualTerminal::text() const {
+  std::string out;
+  for (int r = 0; r < rows; ++r)
+    out += row(r) + "\n";
+  return out;
+}
+
+int VirtualTerminal::cellsChanged(const VirtualTerminal &other) const {
+  int changed = 0;
+  for (std::size_t i = 0; i < cells.size() && i < other.cells.size(); ++i)
+    if (cells[i] != other.cells[i])
+      changed++;
+  return changed;
+}
+
+void VirtualTerminal::feed(const char *data, std::size_t size) {
+  for (std::size_t i = 0; i < size; ++i) {
+    unsigned char b = (unsigned char)data[i];
+    switch (state) {
+    case State::GROUND:
+      if (utf8Remaining > 0) {
+        if ((b & 0xC0) == 0x80) {
+          utf8Char = (utf8Char << 6) | (b & 0x3F);
+          if (--utf8Remaining == 0)
+            print(utf8Char);
+          continue;
+        }
+        utf8Remaining = 0;
+        print(0xFFFD); // Truncated sequence; handle b normally below
+      }
+      if (b == 0x1B)
+        state = State::ESCAPE;
+      else if (b < 0x20 || b == 0x7F)
+        control((char)b);
+      else if (b < 0x80)
+        print(b);
+      else if ((b & 0xE0) == 0xC0) {
+        utf8Char = b & 0x1F;
+        utf8Remaining = 1;
+      } else if ((b & 0xF0) == 0xE0) {
+        utf8Char = b & 0x0F;
+        utf8Remaining = 2;
+      } else if ((b & 0xF8) == 0xF0) {
+        utf8Char = b & 0x07;
+        utf8Remaining = 3;
+      } else {
+        print(0xFFFD);
+      }
+      break;
+    case State::ESCAPE:
+      if (b == '[') {
+        params.clear();
+        state = State::CSI;
+      } else if (b == '(' || b == ')' || b == '*' || b == '+') {
+        state = State::CHARSET;
+      } else if (b == ']') {
+        state = State::OSC;
+      } else {
+        state = State::GROUND;
+        escape((char)b);
+      }
+      break;
+    case State::CSI:
+      if (b >= 0x40 && b <= 0x7E) {
+        state = State::GROUND;
+        csi((char)b);
+      } else {
+        params += (char)b;
+      }
+      break;
+    case State::CHARSET:
+      state = State::GROUND; // Designated character sets are not drawn
+      break;
+    case State::OSC:
+      if (b == 0x07)
+        state = State::GROUND;
+      else if (b == 0x1B)
+        state = State::OSC_ESCAPE;
+      break;
+    case State::OSC_ESCAPE:
+      state = b == '\\' ? State::GROUND : State::OSC;
+      break;
+    }
+  }
+}
+
+void VirtualTerminal::print(char32_t c) {
+  int w = charWidth(c);
+  if (wrapPending || x + w > cols) {
+    x = 0;
+    lineFeed();
+  }
+  wrapPending = false;
+  cell(x, y) = c;
+  if (w == 2)
+    cell(x + 1, y) = 0;
+  lastPrinted = c;
+  x += w;
+  if (x >= cols) {
+    x = cols - 1;
+    wrapPending = true;
+  }
+}
+
+void VirtualTerminal::control(char c) {
+  switch (c) {
+  case '\r':
+    x = 0;
+    wrapPending = false;
+    break;
+  case '\n':
+  case '\v':
+  case '\f':
+    lineFeed();
+    break;
+  case '\b':
+    if (x > 0)
+      x--;
+    wrapPending = false;
+    break;
+  case '\t':
+    x = std::min(cols - 1, (x / 8 + 1) * 8);
+    break;
+  default:
+    break; // BEL, SO/SI and friends do not touch the grid
+  }
+}
+
+void VirtualTerminal::escape(char c) {
+  switch (c) {
+  case '7':
+    savedX = x;
+    savedY = y;
+    break;
+  case '8':
+    x = savedX;
+    y = savedY;
+    wrapPending = false;
+    break;
+  case 'D':
+    lineFeed();
+    break;
+  case 'E':
+    x = 0;
+    lineFeed();
+    break;
+  case 'M':
+    if (y == scrollTop)
+      scrollDown(scrollTop, scrollBottom, 1);
+    else if (y > 0)
+      y--;
+    break;
+  case '=':
+  case '>':
+    break; // Keypad modes
+  default:
+    unknown++;
+  }
+}
+
+int VirtualTerminal::param(std::size_t index, int fallback) const {
+  std::size_t start = 0;
+  if (!params.empty() && (params[0] == '?' || params[0] == '>'))
+    start = 1;
+  for (std::size_t i = 0; i < index; ++i) {
+    start = params.find(';', start);
+    if (start == std::string::npos)
+      return fallback;
+    start++;
+  }
+  if (start >= params.size() || params[start] < '0' || params[start] > '9')
+    return fallback;
+  int value = std::atoi(params.c_str() + start);
+  return value == 0 ? fallback : value;
+}
+
+void VirtualTerminal::csi(char final) {
+  bool privateMode = !params.empty() && (params[0] == '?' || params[0] == '>');
+  int n = param(0, 1);
+  switch (final) {
+  case 'H':
+  case 'f':
+    y = std::min(rows, param(0, 1)) - 1;
+    x = std::min(cols, param(1, 1)) - 1;
+    break;
+  case 'A':
+    y = std::max(0, y - n);
+    break;
+  case 'B':
+    y = std::min(rows - 1, y + n);
+    break;
+  case 'C':
+    x = std::min(cols - 1, x + n);
+    break;
+  case 'D':
+    x = std::max(0, x - n);
+    break;
+  case 'G':
+  case '`':
+    x = std::min(cols, n) - 1;
+    break;
+  case 'd':
+    y = std::min(rows, n) - 1;
+    break;
+  case 'J':
+    switch (param(0, 0)) {
+    case 0:
+      erase(x, y, cols - 1, rows - 1);
+      break;
+    case 1:
+      erase(0, 0, x, y);
+      break;
+    default:
+      erase(0, 0, cols - 1, rows - 1);
+    }
+    break;
+  case 'K':
+    switch (param(0, 0)) {
+    case 0:
+      erase(x, y, cols - 1, y);
+      break;
+    case 1:
+      erase(0, y, x, y);
+      break;
+    default:
+      erase(0, y, cols - 1, y);
+    }
+    break;
+  case 'X':
+    erase(x, y, std::min(cols - 1, x + n - 1), y);
+    break;
+  case 'P': {
+    char32_t *line = &cell(0, y);
+    n = std::min(n, cols - x);
+    std::copy(line + x + n, line + cols, line + x);
+    std::fill(line + cols - n, line + cols, U' ');
+    break;
+  }
+  case '@': {
+    char32_t *line = &cell(0, y);
+    n = std::min(n, cols - x);
+    std::copy_backward(line + x, line + cols - n, line + cols);
+    std::fill(line + x, line + x + n, U' ');
+    break;
+  }
+  case 'L':
+    if (y >= scrollTop && y <= scrollBottom)
+      scrollDown(y, scrollBottom, n);
+    break;
+  case 'M':
+    if (y >= scrollTop && y <= scrollBottom)
+      scrollUp(y, scrollBottom, n);
+    break;
+  case 'S':
+    scrollUp(scrollTop, scrollBottom, n);
+    break;
+  case 'T':
+    scrollDown(scrollTop, scrollBottom, n);
+    break;
+  case 'b':
+    for (int i = 0; i < n; ++i)
+      print(lastPrinted);
+    return;
+  case 'r':
+    if (privateMode)
+      break; // Restore DEC private modes
+    scrollTop = std::min(rows, param(0, 1)) - 1;
+    scrollBottom = std::min(rows, param(1, rows)) - 1;
+    if (scrollTop >= scrollBottom) {
+      scrollTop = 0;
+      scrollBottom = rows - 1;
+    }
+    x = y = 0;
+    break;
+  case 'm': // Attributes and colours
+  case 'h': // Modes, including the alternate screen
+  case 'l':
+  case 'n': // Status reports
+  case 'c':
+  case 't':
+  case 's':
+    break;
+  default:
+    unknown++;
+    return;
+  }
+  wrapPending = false;
+}
+
+void VirtualTerminal::lineFeed() {
+  if (y == scrollBottom)
+    scrollUp(scrollTop, scrollBottom, 1);
+  else if (y < rows - 1)
+    y++;
+}
+
+void VirtualTerminal::scrollUp(int top, int bottom, int count) {
+  count = std::min(count, bottom - top + 1);
+  auto first = cells.begin() + (std::size_t)top * cols;
+  auto last = cells.begin() + (std::size_t)(bottom + 1) * cols;
+  std::copy(first + (std::size_t)count * cols, last, first);
+  std::fill(last - (std::size_t)count * cols, last, U' ');
+}
+
+void VirtualTerminal::scrollDown(int top, int bottom, int count) {
+  count = std::min(count, bottom - top + 1);
+  auto first = cells.begin() + (std::size_t)top * cols;
+  auto last = cells.begin() + (std::size_t)(bottom + 1) * cols;
+  std::copy_backward(first, last - (std::size_t)count * cols, last);
+  std::fill(first, first + (std::size_t)count * cols, U' ');
+}
+
+void VirtualTerminal::erase(int fromX, int fromY, int toX, int toY) {
+  std::size_t from = (std::size_t)fromY * cols + fromX;
+  std::size_t to = (std::size_t)toY * cols + toX;
+  if (from <= to && to < cells.size())
+    std::fill(cells.begin() + from, cells.begin() + to + 1, U' ');
+}
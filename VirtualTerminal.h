@@ -0,0 +1,67 @@
+#ifndef VIRTUALTERMINAL_H
+#define VIRTUALTERMINAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Just enough of an xterm to replay what ncurses writes for TERM=xterm into
+// a grid of cells: cursor movement, erasing, scrolling, UTF-8 text and wide
+// (CJK) characters. Attributes and colours are parsed and dropped, so grids
+// compare on text and position only.
+class VirtualTerminal {
+public:
+  VirtualTerminal(int width, int height);
+
+  void feed(const char *data, std::size_t size);
+  void feed(const std::string &data) { feed(data.data(), data.size()); }
+
+  int width() const { return cols; }
+  int height() const { return rows; }
+  int cursorX() const { return x; }
+  int cursorY() const { return y; }
+
+  // Code point in a cell; 0 for the right half of a wide character.
+  char32_t at(int column, int row) const;
+  std::string row(int index) const; // UTF-8, trailing blanks trimmed
+  std::string text() const;         // All rows, newline terminated
+
+  // Cells whose contents differ from `other` (same size assumed).
+  int cellsChanged(const VirtualTerminal &other) const;
+  // Escape sequences that were not understood; nonzero means the grid may
+  // not match what a real terminal shows.
+  std::uint64_t unknownSequences() const { return unknown; }
+
+  static int charWidth(char32_t c);
+
+private:
+  enum class State { GROUND, ESCAPE, CSI, CHARSET, OSC, OSC_ESCAPE };
+
+  void print(char32_t c);
+  void control(char c);
+  void escape(char c);
+  void csi(char final);
+  int param(std::size_t index, int fallback) const;
+  void lineFeed();
+  void scrollUp(int top, int bottom, int count);
+  void scrollDown(int top, int bottom, int count);
+  void erase(int fromX, int fromY, int toX, int toY); // Inclusive
+  char32_t &cell(int column, int row);
+
+  int cols, rows;
+  std::vector<char32_t> cells;
+  int x, y;
+  bool wrapPending; // Cursor sits past the last column (xterm "xenl")
+  int savedX, savedY;
+  int scrollTop, scrollBottom;
+  char32_t lastPrinted; // For REP (CSI b)
+
+  State state;
+  std::string params; // CSI parameter and intermediate bytes
+  char32_t utf8Char;
+  int utf8Remaining;
+  std::uint64_t unknown;
+};
+
+#endif // VIRTUALTERMINAL_H
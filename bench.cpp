@@ -0,0 +1,298 @@
+// Headless workload: seeded problem generation on every difficulty, scripted
+// game frames drawn to a null terminal, and a real Game session (logic thread,
+// frame publishing and render loop) played through a pipe. `make pgo` runs it
+// as the profile training run; on its own it is a quick way to compare builds.
+// With --alloc-check (in a `make allocs` build) it fails if any game frame or
+// logic tick after warm-up allocates, answers and new problems included.
+// Last, it draws the frames with and without --trace to report its overhead.
+#include "AllocTracker.h"
+#include "Game.h"
+#include "MathGenerator.h"
+#include "ProblemClassifier.h"
+#include "ReviewScheduler.h"
+#include "Tracer.h"
+#include "UI.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// CPU time of the whole process, so a traced run also pays for the flusher.
+static double cpuSeconds() {
+  timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void benchGeneration(long problems) {
+  const char *names[] = {"Easy", "Medium", "Hard", "Expert", "Master"};
+  for (int d = 0; d < 5; ++d) {
+    MathGenerator gen;
+    gen.setSeed(2026 + d);
+    gen.setDifficulty((Difficulty)d);
+    long checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < problems; ++i) {
+      MathProblem p = gen.problemAt(1 + (int)(i / 10), i);
+      checksum += p.correctAnswer + ProblemClassifier::score(p);
+    }
+    double seeded = elapsedSeconds(start);
+
+    // The unseeded path the game uses by default, chaining results.
+    gen.clearSeed();
+    ReviewScheduler reviews;
+    gen.setReviewScheduler(&reviews, 0.25f);
+    int previous = 0;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < problems; ++i) {
+      if (i % 10 == 0)
+        gen.startNewLevel();
+      MathProblem p = gen.generateProblem(previous, (int)i);
+      previous = p.correctAnswer;
+      if (i % 7 == 0)
+        reviews.recordMiss(
+            ReviewScheduler::normalize(p.op, p.operandA, p.operandB),
+            (std::uint64_t)i);
+      checksum += p.correctAnswer;
+    }
+    double chained = elapsedSeconds(start);
+
+    std::printf("generate %-6s seeded %7.1f ns/problem, chained %7.1f "
+                "ns/problem (checksum %ld)\n",
+                names[d], seeded * 1e9 / problems, chained * 1e9 / problems,
+                checksum);
+  }
+}
+
+// Frames drawn before the allocation check starts; ncurses grows its
+// internal buffers during the first few.
+static const long kWarmupFrames = 100;
+
+// Returns false if the terminal could not be opened. `allocatingFrames` gets
+// the number of post-warm-up frames that allocated, `elapsed` the time taken.
+// Frames carry the same trace scopes as the game's render loop.
+static bool drawFrames(long frames, long &allocatingFrames, double &elapsed) {
+  FILE *out = std::fopen("/dev/null", "w");
+  FILE *in = std::fopen("/dev/null", "r");
+  if (out == nullptr || in == nullptr)
+    return false;
+
+  {
+    UI ui;
+    if (!ui.initHeadless(out, in))
+      return false;
+    ui.loadLanguage("English");
+
+    MathGenerator gen;
+    gen.setSeed(1);
+    gen.setDifficulty(Difficulty::MASTER);
+
+    // Scripted session: answer correctly every 30 frames, level up every 10
+    // answers, like a player holding a steady pace.
+    int score = 0, level = 1, challengesPassed = 0;
+    float timeLeft = 1.0f;
+    MathProblem problem = gen.problemAt(level, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    for (long frame = 0; frame < frames; ++frame) {
+      // The answer's new problem counts toward its frame, as it does in the
+      // game's logic tick.
+      TraceScope trace("frame", "ui");
+      AllocScope allocScope(Subsystem::UI);
+      FrameAllocations frameAllocations(Subsystem::UI);
+      ui.getInput();
+      timeLeft -= 0.00083f;
+      if (frame % 30 == 29) {
+        score += 10 * level;
+        challengesPassed++;
+        if (challengesPassed % 10 == 0)
+          level++;
+        TraceScope trace("generateProblem", "generator");
+        problem = gen.problemAt(level, challengesPassed);
+        timeLeft = 1.0f;
+      }
+      {
+        TraceScope trace("drawGame", "ui");
+        ui.drawGame(score, level, challengesPassed, problem.view(), timeLeft);
+      }
+      {
+        TraceScope trace("refresh", "ui");
+        ui.present();
+      }
+      if (frame >= kWarmupFrames && frameAllocations.count() > 0)
+        allocatingFrames++;
+    }
+    elapsed = elapsedSeconds(start);
+    ui.cleanup();
+  }
+  std::fclose(out);
+  std::fclose(in);
+  return true;
+}
+
+static bool benchFrames(long frames, long &allocatingFrames) {
+  double elapsed = 0.0;
+  if (!drawFrames(frames, allocatingFrames, elapsed))
+    return false;
+  std::printf("frame    %7.2f us/frame\n", elapsed * 1e6 / frames);
+  return true;
+}
+
+// Untraced and traced runs alternate so drift in the machine's speed hits
+// both; the median of the pairs' ratios is reported.
+static const int kTracePairs = 31;
+
+// Reports how much more CPU time frames take with --trace on, the flusher's
+// formatting and writing included. Returns false if the terminal or the trace
+// file could not be opened.
+static bool benchTraceOverhead(long frames) {
+  char path[] = "/tmp/bench-trace-XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0)
+    return false;
+  close(fd);
+
+  std::vector<double> ratios;
+  long allocating = 0; // Not checked: each run warms up a new terminal
+  bool ok = true;
+  for (int pair = 0; ok && pair < kTracePairs; ++pair) {
+    double elapsed = 0.0;
+    double start = cpuSeconds();
+    ok = drawFrames(frames, allocating, elapsed);
+    double plain = cpuSeconds() - start;
+    if (ok && !Tracer::start(path))
+      ok = false;
+    if (ok) {
+      start = cpuSeconds();
+      ok = drawFrames(frames, allocating, elapsed);
+      Tracer::stop(); // Joins the flusher and writes what is left
+      ratios.push_back((cpuSeconds() - start) / plain);
+    }
+  }
+  unlink(path);
+  if (ok) {
+    std::sort(ratios.begin(), ratios.end());
+    std::printf("trace    %+7.2f%% per frame with tracing on (target under "
+                "1%%, %llu events dropped)\n",
+                (ratios[kTracePairs / 2] - 1.0) * 100.0,
+                (unsigned long long)Tracer::droppedEvents());
+  }
+  return ok;
+}
+
+// How long the scripted player waits after a menu key and after an answer:
+// several logic ticks and frames pass in between.
+static const int kKeyPauseMs = 100;
+static const int kThinkMs = 300;
+
+// Plays `rounds` rounds of the real game on a null terminal, with keys written
+// into a pipe by a scripted player: start, three answers (a wrong one ends the
+// round early), back to the menu. The first round is warm-up; `allocating`
+// gets the number of logic ticks and drawn frames after it that allocated.
+// Returns false if the game could not start.
+static bool benchGameSession(int rounds, long &allocating) {
+  int pipeFds[2];
+  if (pipe(pipeFds) != 0)
+    return false;
+  FILE *out = std::fopen("/dev/null", "w");
+  FILE *in = fdopen(pipeFds[0], "r");
+  if (out == nullptr || in == nullptr)
+    return false;
+
+  auto allocatingNow = [] {
+    return (long)(AllocTracker::stats(Subsystem::GAME_LOOP).allocatingFrames +
+                  AllocTracker::stats(Subsystem::UI).allocatingFrames);
+  };
+  long afterWarmup = 0;
+  auto start = std::chrono::steady_clock::now();
+  bool started = false;
+  {
+    Game game("xterm", out, in, "bench");
+    started = game.hasTerminal();
+    std::thread player([&] {
+      auto press = [&](const char *key, int pauseMs = kKeyPauseMs) {
+        if (write(pipeFds[1], key, std::strlen(key)) < 0)
+          std::perror("bench: write");
+        std::this_thread::sleep_for(std::chrono::milliseconds(pauseMs));
+      };
+      const char *answers[] = {"\033OD", "\033OA", "\033OC"}; // L, U, R
+      for (int round = 0; started && round < rounds; ++round) {
+        press("\n", kThinkMs);
+        for (const char *answer : answers)
+          press(answer, kThinkMs);
+        press(" "); // Leaves the game over screen; ignored in gameplay
+        press("q"); // Quits to the menu from gameplay or a level screen
+        if (round == 0)
+          afterWarmup = allocatingNow();
+      }
+      press("\033OA"); // Exit, wrapping up from Start
+      press("\n");
+    });
+    if (started)
+      game.run();
+    player.join();
+  }
+  allocating = allocatingNow() - afterWarmup;
+  close(pipeFds[1]);
+  std::fclose(in);
+  std::fclose(out);
+  if (started)
+    std::printf("session  %7.2f s for %d rounds\n", elapsedSeconds(start),
+                rounds);
+  return started;
+}
+
+int main(int argc, char *argv[]) {
+  long scale = 1;
+  bool allocCheck = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--quick")
+      scale = 0;
+    else if (arg == "--alloc-check")
+      allocCheck = true;
+  }
+  if (allocCheck && !AllocTracker::compiledIn()) {
+    std::fprintf(stderr, "bench: --alloc-check needs a `make allocs` build\n");
+    return 1;
+  }
+
+  benchGeneration(scale ? 200000 : 10000);
+  long allocatingFrames = 0;
+  if (!benchFrames(scale ? 20000 : 1000, allocatingFrames)) {
+    std::fprintf(stderr, "bench: could not open a null terminal\n");
+    return 1;
+  }
+  long allocatingSessionFrames = 0;
+  if (!benchGameSession(scale ? 8 : 3, allocatingSessionFrames)) {
+    std::fprintf(stderr, "bench: could not start a headless game\n");
+    return 1;
+  }
+  if (AllocTracker::compiledIn())
+    AllocTracker::printSummary(stdout);
+  if (allocCheck && (allocatingFrames > 0 || allocatingSessionFrames > 0)) {
+    std::fprintf(stderr,
+                 "bench: %ld steady-state frames and %ld game ticks or frames "
+                 "allocated\n",
+                 allocatingFrames, allocatingSessionFrames);
+    return 1;
+  }
+  // Last, so the allocation summary above covers only the game's workload.
+  if (!benchTraceOverhead(scale ? 2000 : 500)) {
+    std::fprintf(stderr, "bench: could not trace to a temporary file\n");
+    return 1;
+  }
+  return 0;
+}
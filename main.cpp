@@ -1,7 +1,240 @@
+#include "AllocTracker.h"
 #include "Game.h"
+#include "Grader.h"
+#include "Kiosk.h"
+#include "Metrics.h"
+#include "ProblemBank.h"
+#include "Scoreboard.h"
+#include "Tracer.h"
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
 
-int main() {
-  Game game;
-  game.run();
-  return 0;
+// A whole non-negative decimal number, without signs, spaces or overflow.
+static bool parseUnsigned(const char *text, std::uint64_t &value) {
+  if (!std::isdigit((unsigned char)text[0]))
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  value = std::strtoull(text, &end, 10);
+  return errno == 0 && *end == '\0';
+}
+
+// The filter grows with the window, a little under 3 bytes per problem.
+static const std::uint64_t kMaxRepeatWindow = 1000000;
+
+// `value` is null when the flag came without one.
+static int usageError(const char *flag, const char *value,
+                      const char *expected) {
+  if (value == nullptr)
+    std::fprintf(stderr, "%s: expected %s\n", flag, expected);
+  else
+    std::fprintf(stderr, "%s: expected %s, got '%s'\n", flag, expected, value);
+  return 1;
+}
+
+// Every option, with how many values follow it and what they should be.
+struct Option {
+  const char *name;
+  int values;
+  const char *expected;
+};
+static const Option kOptions[] = {
+    {"--seed", 1, "a non-negative integer"},
+    {"--daily", 0, nullptr},
+    {"--review-rate", 1, "a share from 0 to 1"},
+    {"--repeat-window", 1, "a number of problems from 0 to 1000000"},
+    {"--trace", 1, "a trace file path"},
+    {"--rules", 1, "a rules file"},
+    {"--print-rules", 0, nullptr},
+    {"--metrics", 1, "a port or a socket path"},
+    {"--grade", 1, "an answer log"},
+    {"--language", 1, "a language name such as German or Japanese"},
+    {"--threads", 1, "a thread count"},
+    {"--seat", 1, "a terminal device"},
+    {"--scoreboard", 0, nullptr},
+    {"--make-bank", 2, "a CSV file and a bank file"},
+};
+
+static const Option *findOption(const std::string &name) {
+  for (const Option &option : kOptions)
+    if (name == option.name)
+      return &option;
+  return nullptr;
+}
+
+int main(int argc, char *argv[]) {
+  bool seeded = false;
+  std::uint64_t seed = 0;
+  float reviewRate = -1.0f;
+  std::uint64_t repeatWindow = 0;
+  bool repeatWindowSet = false;
+  std::string tracePath;
+  std::string metricsAddress;
+  GenerationRules rules;
+  bool viewScoreboard = false;
+  std::string gradePath;
+  std::string language = "English";
+  int threads = 0;
+  std::vector<std::string> seats; // Kiosk terminals, DEVICE[:TYPE]
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    const Option *option = findOption(arg);
+    if (option == nullptr)
+      return usageError("unlimitedmath", argv[i], "an option such as --seed");
+    if (argc - 1 - i < option->values)
+      return usageError(option->name, nullptr, option->expected);
+
+    if (arg == "--seed") {
+      seeded = true;
+      if (!parseUnsigned(argv[++i], seed))
+        return usageError("--seed", argv[i], "a non-negative integer");
+    } else if (arg == "--daily") {
+      seeded = true;
+      seed = std::time(nullptr) / 86400; // Days since the epoch (UTC)
+    } else if (arg == "--review-rate") {
+      char *end = nullptr;
+      reviewRate = std::strtof(argv[++i], &end);
+      if (end == argv[i] || *end != '\0' || !(reviewRate >= 0.0f) ||
+          reviewRate > 1.0f)
+        return usageError("--review-rate", argv[i], "a share from 0 to 1");
+    } else if (arg == "--repeat-window") {
+      repeatWindowSet = true;
+      if (!parseUnsigned(argv[++i], repeatWindow) ||
+          repeatWindow > kMaxRepeatWindow)
+        return usageError("--repeat-window", argv[i],
+                          "a number of problems from 0 to 1000000");
+    } else if (arg == "--trace") {
+      tracePath = argv[++i];
+    } else if (arg == "--rules") {
+      std::string error;
+      if (!rules.load(argv[++i], error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+      }
+    } else if (arg == "--print-rules") {
+      std::fputs(GenerationRules::defaultText(), stdout);
+      return 0;
+    } else if (arg == "--metrics") {
+      metricsAddress = argv[++i];
+    } else if (arg == "--grade") {
+      gradePath = argv[++i];
+    } else if (arg == "--language") {
+      language = argv[++i];
+      if (!UI::isLanguage(language))
+        return usageError("--language", argv[i],
+                          "a language name such as German or Japanese");
+    } else if (arg == "--threads") {
+      std::uint64_t value = 0;
+      if (!parseUnsigned(argv[++i], value) ||
+          value > (std::uint64_t)Grader::maxThreads()) {
+        std::string expected =
+            "a thread count from 0 to " + std::to_string(Grader::maxThreads());
+        return usageError("--threads", argv[i], expected.c_str());
+      }
+      threads = (int)value;
+    } else if (arg == "--seat") {
+      seats.push_back(argv[++i]);
+    } else if (arg == "--scoreboard") {
+      viewScoreboard = true;
+    } else if (arg == "--make-bank") {
+      std::string error;
+      if (!ProblemBank::convertCsv(argv[i + 1], argv[i + 2], error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+      }
+      return 0;
+    }
+  }
+
+  if (!gradePath.empty()) {
+    Grader grader(rules, threads);
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    if (!grader.gradeFile(gradePath, stdout, error)) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    std::fflush(stdout);
+    grader.printSummary(stderr, std::chrono::duration<double>(
+                                    std::chrono::steady_clock::now() - start)
+                                    .count());
+    return 0;
+  }
+
+  if (viewScoreboard) {
+    Scoreboard board;
+    if (!board.open(true)) {
+      std::fprintf(stderr, "Could not open the shared scoreboard\n");
+      return 1;
+    }
+    UI ui;
+    ui.init();
+    ui.loadLanguage(language);
+    ui.showScoreboard(board);
+    ui.cleanup();
+    return 0;
+  }
+
+  if (!tracePath.empty() && !Tracer::start(tracePath)) {
+    std::fprintf(stderr, "Could not open trace file %s\n", tracePath.c_str());
+    return 1;
+  }
+
+  if (!metricsAddress.empty() && !Metrics::start(metricsAddress)) {
+    std::fprintf(stderr, "Could not listen for metrics on %s\n",
+                 metricsAddress.c_str());
+    Tracer::stop();
+    return 1;
+  }
+
+  auto configure = [&](Game &game) {
+    if (seeded)
+      game.setSeed(seed);
+    if (reviewRate >= 0.0f)
+      game.setReviewRate(reviewRate);
+    if (repeatWindowSet)
+      game.setRepeatWindow((std::size_t)repeatWindow);
+    game.setRules(rules);
+    game.setLanguage(language);
+  };
+
+  int status = 0;
+  if (!seats.empty()) {
+    Kiosk kiosk;
+    std::string error;
+    for (const std::string &seat : seats) {
+      std::size_t colon = seat.find(':');
+      std::string device = seat.substr(0, colon);
+      std::string type =
+          colon == std::string::npos ? "xterm" : seat.substr(colon + 1);
+      Game *game = kiosk.addSeat(device, type, error);
+      if (game == nullptr)
+        break;
+      configure(*game);
+    }
+    if (error.empty() && kiosk.run(error))
+      kiosk.printUsage(stderr);
+    if (!error.empty()) {
+      std::fprintf(stderr, "%s\n", error.c_str());
+      status = 1;
+    }
+  } else {
+    Game game;
+    configure(game);
+    game.run();
+  }
+
+  Metrics::stop();
+  Tracer::stop();
+  if (AllocTracker::compiledIn())
+    AllocTracker::printSummary(stderr);
+  return status;
 }
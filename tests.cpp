@@ -1,6 +1,30 @@
+#include "Game.h"
+#include "GenerationRules.h"
+#include "Grader.h"
 #include "MathGenerator.h"
+#include "Metrics.h"
+#include "ProblemBank.h"
+#include "ProblemClassifier.h"
+#include "ProblemFilter.h"
+#include "ReviewScheduler.h"
+#include "Scoreboard.h"
+#include "VirtualTerminal.h"
+#include <algorithm>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <unistd.h>
 #include <iostream>
+#include <map>
+#include <set>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 void testDifficultyEasy() {
@@ -114,12 +138,647 @@ void testUniqueOperands() {
   std::cout << "testUniqueOperands passed." << std::endl;
 }
 
+void testSeededDeterminism() {
+  MathGenerator genA, genB;
+  genA.setSeed(20261018);
+  genB.setSeed(20261018);
+  genA.setDifficulty(Difficulty::MASTER);
+  genB.setDifficulty(Difficulty::MASTER);
+  for (std::uint64_t i = 0; i < 50; ++i) {
+    MathProblem a = genA.problemAt(3, i);
+    MathProblem b = genB.problemAt(3, i);
+    assert(a.question == b.question);
+    assert(a.options == b.options);
+    assert(a.correctOptionIndex == b.correctOptionIndex);
+  }
+
+  MathGenerator other;
+  other.setSeed(20261019);
+  other.setDifficulty(Difficulty::MASTER);
+  int same = 0;
+  for (std::uint64_t i = 0; i < 50; ++i)
+    if (other.problemAt(3, i).question == genA.problemAt(3, i).question)
+      same++;
+  assert(same < 50);
+  std::cout << "testSeededDeterminism passed." << std::endl;
+}
+
+void testSeededRandomAccess() {
+  MathGenerator gen;
+  gen.setSeed(7);
+  gen.setDifficulty(Difficulty::EASY);
+
+  // Jumping far ahead must not depend on what was generated before.
+  const std::uint64_t far = 10000000;
+  MathProblem direct = gen.problemAt(2, far + 5);
+  for (std::uint64_t i = 0; i < 25; ++i)
+    gen.problemAt(2, i);
+  assert(gen.problemAt(2, far + 5).question == direct.question);
+
+  // Chain rule: EASY results are always >= 20, so every problem after the
+  // first of a chain starts with the previous result.
+  for (std::uint64_t i = far; i < far + 20; ++i) {
+    if (i % MathGenerator::kChainLength == 0)
+      continue;
+    std::string prev = std::to_string(gen.problemAt(2, i - 1).correctAnswer);
+    assert(gen.problemAt(2, i).question.compare(0, prev.size() + 1,
+                                                prev + " ") == 0);
+  }
+  std::cout << "testSeededRandomAccess passed." << std::endl;
+}
+
+void testSeededUniqueOperands() {
+  MathGenerator gen;
+  gen.setSeed(99);
+  gen.setDifficulty(Difficulty::EASY);
+  for (int level = 1; level <= 5; ++level) {
+    std::vector<int> usedBs;
+    std::uint64_t first = (level - 1) * MathGenerator::kChainLength;
+    for (std::uint64_t i = first; i < first + MathGenerator::kChainLength;
+         ++i) {
+      MathProblem p = gen.problemAt(level, i);
+      int b = std::stoi(p.question.substr(p.question.find_last_of(' ') + 1));
+      for (int used : usedBs)
+        assert(used != b);
+      usedBs.push_back(b);
+    }
+  }
+  std::cout << "testSeededUniqueOperands passed." << std::endl;
+}
+
+void testClassifier() {
+  assert(ProblemClassifier::carries(23, 14) == 0);
+  assert(ProblemClassifier::carries(57, 68) == 2);
+  assert(ProblemClassifier::carries(95, 5) == 2);
+  assert(ProblemClassifier::borrows(52, 17) == 1);
+  assert(ProblemClassifier::borrows(100, 1) == 2);
+  assert(ProblemClassifier::digitCount(-305) == 3);
+
+  assert(ProblemClassifier::score('+', 57, 68) >
+         ProblemClassifier::score('+', 23, 14));
+  assert(ProblemClassifier::score('-', 52, 17) >
+         ProblemClassifier::score('-', 58, 17));
+  assert(ProblemClassifier::score('*', 7, 8) >
+         ProblemClassifier::score('*', 2, 10));
+  assert(ProblemClassifier::score('*', 12, 12) <= ProblemClassifier::kMaxScore);
+  std::cout << "testClassifier passed." << std::endl;
+}
+
+void testDifficultyBand() {
+  MathGenerator gen;
+  gen.setDifficulty(Difficulty::MEDIUM);
+  gen.setDifficultyBand(35, 100); // Two-digit problems with a carry/borrow
+  int inBand = 0;
+  for (int i = 0; i < 100; ++i) {
+    gen.startNewLevel();
+    MathProblem p = gen.generateProblem(0, 0);
+    if (ProblemClassifier::score(p) >= 35)
+      inBand++;
+  }
+  assert(inBand >= 95);
+
+  gen.setDifficultyBand(0, 20); // No carries or borrows
+  for (int i = 0; i < 100; ++i) {
+    gen.startNewLevel();
+    MathProblem p = gen.generateProblem(0, 0);
+    assert(ProblemClassifier::score(p) <= 20);
+    if (p.op == '+')
+      assert(ProblemClassifier::carries(p.operandA, p.operandB) == 0);
+  }
+  std::cout << "testDifficultyBand passed." << std::endl;
+}
+
+void testReviewScheduler() {
+  ReviewScheduler reviews(4);
+  const std::uint64_t t0 = 1000000;
+
+  Fact sevenEights = ReviewScheduler::normalize('*', 8, 7);
+  assert(sevenEights == ReviewScheduler::normalize('*', 7, 8));
+  assert(!(ReviewScheduler::normalize('-', 8, 7) ==
+           ReviewScheduler::normalize('-', 7, 8)));
+
+  reviews.recordMiss(sevenEights, t0);
+  reviews.recordSlow(ReviewScheduler::normalize('+', 57, 68), t0);
+  assert(reviews.size() == 2);
+
+  Fact due;
+  assert(!reviews.takeDue(t0, due)); // Nothing due yet
+  assert(reviews.takeDue(t0 + ReviewScheduler::kFirstIntervalMs, due));
+  assert(due == sevenEights); // Misses come back before slow answers
+
+  // Answering correctly keeps growing the interval until the fact retires.
+  std::uint64_t now = t0;
+  for (int i = 0; i < 20 && reviews.contains(sevenEights); ++i) {
+    now += ReviewScheduler::kRetireIntervalMs;
+    reviews.recordCorrect(sevenEights, now);
+  }
+  assert(!reviews.contains(sevenEights));
+  assert(reviews.size() == 1);
+
+  // Memory is bounded: a full scheduler drops its least urgent fact, the one
+  // due last, and keeps the overdue ones the learner most needs.
+  for (int i = 0; i < 10; ++i)
+    reviews.recordMiss(ReviewScheduler::normalize('+', 10, 10 + i), t0 + i);
+  assert(reviews.size() == reviews.capacity());
+  assert(!reviews.contains(ReviewScheduler::normalize('+', 57, 68))); // Slow
+  for (int i = 10; i <= 12; ++i)
+    assert(reviews.contains(ReviewScheduler::normalize('+', 10, i)));
+  assert(reviews.contains(ReviewScheduler::normalize('+', 10, 19)));
+  assert(!reviews.contains(ReviewScheduler::normalize('+', 10, 13)));
+
+  // A fact pushed later by a correct answer becomes the next one dropped.
+  reviews.recordCorrect(ReviewScheduler::normalize('+', 10, 11), t0 + 20);
+  reviews.recordMiss(ReviewScheduler::normalize('+', 10, 13), t0 + 20);
+  assert(!reviews.contains(ReviewScheduler::normalize('+', 10, 11)));
+  assert(reviews.contains(ReviewScheduler::normalize('+', 10, 19)));
+  assert(reviews.takeDue(t0 + ReviewScheduler::kFirstIntervalMs, due));
+  assert(due == ReviewScheduler::normalize('+', 10, 10));
+  std::cout << "testReviewScheduler passed." << std::endl;
+}
+
+void testReviewMixing() {
+  ReviewScheduler reviews;
+  MathGenerator gen;
+  gen.setDifficulty(Difficulty::EASY);
+  gen.setReviewScheduler(&reviews, 1.0f);
+  reviews.recordMiss(ReviewScheduler::normalize('*', 7, 8), 0); // Long due
+
+  MathProblem p = gen.generateProblem(0, 0);
+  assert(p.question == "7 * 8");
+  assert(p.correctAnswer == 56);
+  assert(p.options[p.correctOptionIndex] == 56);
+
+  // Handed out once, then held back until the answer is recorded.
+  p = gen.generateProblem(0, 0);
+  assert(p.op == '+');
+  std::cout << "testReviewMixing passed." << std::endl;
+}
+
+void testScoreboard() {
+  Scoreboard board;
+  if (!board.open()) {
+    std::cout << "testScoreboard skipped (no shared memory)." << std::endl;
+    return;
+  }
+  assert(board.join("tester"));
+  board.publish(3, 420, 27);
+
+  // The segment is open to every user's games, whatever the umask.
+  struct stat info;
+  int fd = shm_open("/unlimitedmath-scoreboard", O_RDONLY, 0);
+  assert(fd >= 0 && fstat(fd, &info) == 0);
+  close(fd);
+  if (info.st_uid == getuid())
+    assert((info.st_mode & 0777) == 0666);
+
+  Scoreboard viewer;
+  assert(viewer.open(true));
+  assert(!viewer.join("viewer")); // Read-only
+  ScoreEntry entries[Scoreboard::kMaxSessions];
+  int count = viewer.snapshot(entries, Scoreboard::kMaxSessions);
+  bool found = false;
+  for (int i = 0; i < count; ++i) {
+    if (entries[i].pid == (int)getpid()) {
+      found = true;
+      assert(std::strcmp(entries[i].player, "tester") == 0);
+      assert(entries[i].level == 3);
+      assert(entries[i].score == 420);
+      assert(entries[i].challengesPassed == 27);
+    }
+  }
+  assert(found);
+
+  board.leave();
+  count = viewer.snapshot(entries, Scoreboard::kMaxSessions);
+  for (int i = 0; i < count; ++i)
+    assert(entries[i].pid != (int)getpid());
+  std::cout << "testScoreboard passed." << std::endl;
+}
+
+void testProblemFilter() {
+  ProblemFilter filter(1000, 0.01);
+  for (int i = 0; i < 1000; ++i)
+    filter.insert('+', i, 7);
+  for (int i = 0; i < 1000; ++i)
+    assert(filter.contains('+', i, 7)); // No false negatives
+
+  // Measured false-positive rate stays near the design rate.
+  int falsePositives = 0;
+  const int probes = 100000;
+  for (int i = 0; i < probes; ++i)
+    if (filter.contains('-', i, 7))
+      falsePositives++;
+  double measured = (double)falsePositives / probes;
+  assert(filter.expectedFalsePositiveRate() <= 0.012);
+  assert(measured <= 2 * filter.expectedFalsePositiveRate());
+  std::cout << "  false positives: " << measured * 100 << "% measured, "
+            << filter.expectedFalsePositiveRate() * 100 << "% expected, "
+            << filter.memoryBytes() << " bytes" << std::endl;
+
+  // Old problems fall out once two windows have gone by.
+  for (int i = 0; i < 2000; ++i)
+    filter.insert('*', i, 3);
+  int remembered = 0;
+  for (int i = 0; i < 1000; ++i)
+    if (filter.contains('+', i, 7))
+      remembered++;
+  assert(remembered < 50);
+
+  // Commuted operands are the same problem; non-commutative ones are not.
+  ProblemFilter facts(64);
+  facts.insert('*', 8, 7);
+  facts.insert('-', 9, 4);
+  assert(facts.contains('*', 7, 8) && facts.contains('*', 8, 7));
+  assert(!facts.contains('-', 4, 9));
+  std::cout << "testProblemFilter passed." << std::endl;
+}
+
+void testSessionFilter() {
+  ProblemFilter filter(1024);
+  MathGenerator gen;
+  gen.setDifficulty(Difficulty::EASY);
+  gen.setSessionFilter(&filter);
+
+  std::set<std::tuple<char, int, int>> seen;
+  for (int i = 0; i < 500; ++i) {
+    if (i % 10 == 0)
+      gen.startNewLevel();
+    MathProblem p = gen.generateProblem(0, i);
+    assert(seen.insert(std::make_tuple(p.op, p.operandA, p.operandB)).second);
+  }
+  std::cout << "testSessionFilter passed." << std::endl;
+}
+
+void testProblemBank() {
+  const std::string csvPath = "/tmp/unlimitedmath_test_bank.csv";
+  const std::string bankPath = "/tmp/unlimitedmath_test_bank.umb";
+  {
+    std::ofstream csv(csvPath);
+    csv << "question,answer,wrong,wrong\n"
+        << "7 * 8,56,54,58\n"
+        << "sqrt(144),12\n"
+        << "\"Half of 30\",15\n";
+  }
+  std::string error;
+  assert(ProblemBank::convertCsv(csvPath, bankPath, error));
+
+  ProblemBank bank;
+  assert(bank.open(bankPath));
+  assert(bank.size() == 3);
+
+  ProblemView p = bank.at(0);
+  assert(p.question == "7 * 8");
+  assert(p.correctAnswer == 56);
+  assert(p.options[p.correctOptionIndex] == 56);
+  assert(p.op == '*' && p.operandA == 7 && p.operandB == 8);
+  int wrongSum = p.options[0] + p.options[1] + p.options[2] - 56;
+  assert(wrongSum == 54 + 58);
+
+  p = bank.at(1);
+  assert(p.op == 's' && p.operandA == 144 && p.correctAnswer == 12);
+  p = bank.at(2);
+  assert(p.question == "Half of 30");
+  assert(p.op == 0);
+  for (int i = 0; i < 3; ++i)
+    if (i != p.correctOptionIndex)
+      assert(p.options[i] != 15);
+
+  // Distractors that are not numbers, or would give the answer away, are
+  // reported with their line.
+  const char *badRows[] = {"7 * 8,56,fifty,58\n", "7 * 8,56,56,58\n",
+                           "7 * 8,56,58,58\n"};
+  for (const char *row : badRows) {
+    std::ofstream(csvPath) << "question,answer,wrong,wrong\n" << row;
+    assert(!ProblemBank::convertCsv(csvPath, bankPath + ".bad", error));
+    assert(error.find(csvPath + ":2:") == 0);
+  }
+
+  // Anything that is not a bank is refused.
+  assert(!bank.open(csvPath));
+  assert(!bank.isOpen());
+  std::remove(csvPath.c_str());
+  std::remove(bankPath.c_str());
+  std::cout << "testProblemBank passed." << std::endl;
+}
+
+// Fetches the metrics page over the Unix socket the way a scraper would.
+static std::string scrape(const std::string &path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  assert(fd >= 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  assert(connect(fd, (sockaddr *)&addr, sizeof(addr)) == 0);
+  const char request[] = "GET /metrics HTTP/1.0\r\n\r\n";
+  assert(write(fd, request, sizeof(request) - 1) > 0);
+  std::string response;
+  char buffer[4096];
+  ssize_t n;
+  while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+    response.append(buffer, n);
+  close(fd);
+  return response;
+}
+
+void testMetrics() {
+  const std::string path = "/tmp/unlimitedmath_test_metrics.sock";
+  // Nothing is counted while metrics are off.
+  Metrics::problemGenerated(Difficulty::EASY, '+');
+  assert(Metrics::start("unix:" + path));
+  assert(!Metrics::start(path)); // Already listening
+
+  Metrics::problemGenerated(Difficulty::EASY, '+');
+  Metrics::answer(Difficulty::EASY, '+', AnswerOutcome::CORRECT, 700);
+  Metrics::levelReached(3);
+  // Counts from threads that have already exited are kept.
+  std::thread worker([] {
+    Metrics::problemGenerated(Difficulty::EASY, '+');
+    Metrics::answer(Difficulty::MASTER, 's', AnswerOutcome::TIMEOUT, 20000);
+    Metrics::generatorRetries(5);
+    Metrics::levelReached(2);
+    Metrics::frameTime(3000);
+  });
+  worker.join();
+
+  std::string page = scrape(path);
+  assert(page.compare(0, 15, "HTTP/1.0 200 OK") == 0);
+  assert(page.find("unlimitedmath_problems_generated_total{difficulty=\"easy\","
+                   "op=\"add\"} 2\n") != std::string::npos);
+  assert(page.find("unlimitedmath_answers_total{outcome=\"correct\","
+                   "difficulty=\"easy\",op=\"add\"} 1\n") !=
+         std::string::npos);
+  assert(page.find("unlimitedmath_answers_total{outcome=\"timeout\","
+                   "difficulty=\"master\",op=\"sqrt\"} 1\n") !=
+         std::string::npos);
+  assert(page.find("unlimitedmath_generator_retries_total 5\n") !=
+         std::string::npos);
+  assert(page.find("unlimitedmath_level_reached 3\n") != std::string::npos);
+  // 700 ms lands in the 1 s bucket; timeouts carry no latency.
+  assert(page.find("unlimitedmath_answer_latency_seconds_bucket"
+                   "{le=\"0.5\"} 0\n") != std::string::npos);
+  assert(page.find("unlimitedmath_answer_latency_seconds_bucket"
+                   "{le=\"1\"} 1\n") != std::string::npos);
+  assert(page.find("unlimitedmath_answer_latency_seconds_count 1\n") !=
+         std::string::npos);
+  assert(page.find("unlimitedmath_frame_seconds_bucket{le=\"0.004\"} 1\n") !=
+         std::string::npos);
+
+  Metrics::stop();
+  assert(access(path.c_str(), F_OK) != 0); // Socket removed
+
+  // Any unix: address is a socket path, and only sockets are replaced.
+  assert(Metrics::start("unix:unlimitedmath_test_metrics.sock"));
+  assert(access("unlimitedmath_test_metrics.sock", F_OK) == 0);
+  Metrics::stop();
+  const std::string file = "/tmp/unlimitedmath_test_metrics.txt";
+  std::ofstream(file) << "keep me\n";
+  assert(!Metrics::start(file));
+  assert(access(file.c_str(), F_OK) == 0);
+  std::remove(file.c_str());
+  std::cout << "testMetrics passed." << std::endl;
+}
+
+void testVirtualTerminal() {
+  VirtualTerminal term(10, 3);
+  // Clear, absolute moves, repeat and erase as ncurses emits them for xterm.
+  term.feed("\033[H\033[2Jab\033[2;4Hx\033[3b\033[3;1Hhello\033[3;3H\033[K");
+  assert(term.row(0) == "ab");
+  assert(term.row(1) == "   xxxx");
+  assert(term.row(2) == "he");
+  // Attributes and charset switches do not reach the grid.
+  term.feed("\033[1;1H\033[32m\033(Bq\033[0m\033[?25l");
+  assert(term.row(0) == "qb");
+  assert(term.unknownSequences() == 0);
+
+  // Wide characters take two cells; text() drops the right halves.
+  VirtualTerminal before = term;
+  term.feed("\033[1;1H\xe6\x95\xb0\xe5\xad\xa6!");
+  assert(term.at(0, 0) == 0x6570 && term.at(1, 0) == 0);
+  assert(term.row(0) == "\xe6\x95\xb0\xe5\xad\xa6!");
+  assert(term.cursorX() == 5);
+  assert(term.cellsChanged(before) == 5);
+
+  // Writing the last column wraps only when the next character arrives.
+  term.feed("\033[3;9Hyz");
+  assert(term.cursorY() == 2);
+  term.feed("w");
+  assert(term.row(2) == "w");
+  assert(term.row(1) == "he      yz");
+  std::cout << "testVirtualTerminal passed." << std::endl;
+}
+
+void testGenerationRules() {
+  // The built-in rules keep Master at 20% for each of + - * / and 10% for
+  // each root.
+  MathGenerator gen;
+  gen.setSeed(9);
+  gen.setDifficulty(Difficulty::MASTER);
+  std::map<char, int> counts;
+  const int kProblems = 20000;
+  for (int i = 0; i < kProblems; ++i)
+    counts[gen.problemAt(1 + i / 10, i).op]++;
+  for (char op : {'*', 's', 'c'}) {
+    double expected = op == '*' ? 0.2 : 0.1;
+    double share = (double)counts[op] / kProblems;
+    assert(share > expected - 0.02 && share < expected + 0.02);
+  }
+  // + and - also absorb / fallbacks, so only check they dominate.
+  assert(counts['+'] > counts['*'] && counts['-'] > counts['*']);
+
+  // Custom rules: only the listed operator and ranges come out.
+  GenerationRules rules;
+  std::string error;
+  const std::string custom = "[easy]\n"
+                             "*  1  3..4  5..5\n"
+                             "[medium]\n+ 3 10..99 10..30\n- 1 10..99 10..30\n"
+                             "[hard]\n+ 1 1..2 1..2\n"
+                             "[expert]\n+ 1 1..2 1..2\n"
+                             "[master]\nsqrt 1 2..3\n";
+  assert(rules.parse(custom, error));
+  gen.clearSeed();
+  gen.setRules(rules);
+  gen.setDifficulty(Difficulty::EASY);
+  for (int i = 0; i < 100; ++i) {
+    MathProblem p = gen.generateProblem(0, 0);
+    assert(p.op == '*' && p.operandA >= 3 && p.operandA <= 4);
+    assert(p.operandB == 5 && p.correctAnswer == p.operandA * 5);
+  }
+  // Weights 3:1 through the alias table.
+  int plus = 0;
+  for (std::uint32_t r = 0; r < 40000; ++r)
+    if (rules.pick(Difficulty::MEDIUM, (std::uint32_t)(r * 2654435761u) >> 1)
+            .op == '+')
+      plus++;
+  assert(plus > 29000 && plus < 31000);
+
+  // Bad input is reported with its line and leaves the rules as they were.
+  assert(!rules.parse("[easy]\n+ 1 10..99\n", error));
+  assert(error.find(":2:") != std::string::npos);
+  assert(!rules.parse("[easy]\n%  1 1..2 1..2\n", error));
+  assert(!rules.parse("[easy]\n+ 1 1..2 1..2\n", error)); // Missing sections
+  assert(!rules.parse("[master]\nsqrt 1 2..50000\n", error));
+  // Ranges whose span or products do not fit in an int are refused.
+  std::string full = GenerationRules::defaultText();
+  assert(!rules.parse(full + "+ 1 -2147483648..2147483647 10..30\n", error));
+  std::string badLine =
+      ":" + std::to_string(std::count(full.begin(), full.end(), '\n') + 1) +
+      ":";
+  assert(error.find(badLine) != std::string::npos);
+  assert(!rules.parse(full + "- 1 10..99 -1000001..0\n", error));
+  assert(!rules.parse(full + "* 1 2..50000 2..50000\n", error));
+  assert(!rules.parse(full + "/ 1 2..1000000 2..1000 fallback=1..2000000\n",
+                      error));
+  assert(!rules.parse(full + "/ 1 2..1000000 2..3000\n", error));
+  GenerationRules wide;
+  assert(wide.parse(full + "* 1 -1000..1000 2..2000\n", error));
+  assert(rules.operatorCount(Difficulty::MEDIUM) == 2);
+  assert(rules.rule(Difficulty::EASY, 0).op == '*');
+  std::cout << "testGenerationRules passed." << std::endl;
+}
+
+// Chained products used to overflow int (seed 770 asked 299376000 * 8 at
+// index 98); a chain that could overflow restarts from the a-range instead.
+void testChainedResultsFit() {
+  MathGenerator gen;
+  gen.setSeed(770);
+  gen.setDifficulty(Difficulty::HARD);
+  int previous = 0;
+  for (std::uint64_t i = 0; i < 60000; ++i) {
+    MathProblem p = gen.problemAfter(1 + (int)(i / 10), i, previous);
+    previous = p.correctAnswer;
+    long long a = p.operandA, b = p.operandB;
+    long long exact = p.op == '+' ? a + b : p.op == '-' ? a - b : a * b;
+    assert(p.op == '/' || exact == p.correctAnswer);
+  }
+  std::cout << "testChainedResultsFit passed." << std::endl;
+}
+
+// Grades a small log with tiny chunks so sessions land in many chunks and
+// windows, and checks the scores and that output keeps the input order.
+void testGrader() {
+  const std::string logPath = "/tmp/unlimitedmath_test_grader.log";
+  const std::string outPath = "/tmp/unlimitedmath_test_grader.out";
+  const char keys[] = "LUR";
+  MathGenerator gen;
+  gen.setSeed(42);
+  gen.setDifficulty(Difficulty::MEDIUM);
+  {
+    std::ofstream log(logPath);
+    log << "# session seed difficulty answers\n";
+    // 12 right, one wrong, one right but over level 2's 17.5s, one unanswered.
+    log << "alice 42 medium";
+    for (int i = 0; i < 15; ++i) {
+      int right = gen.problemAt(1 + i / 10, i).correctOptionIndex;
+      int option = i == 12 ? (right + 1) % 3 : right;
+      log << ' ' << (i == 14 ? '-' : keys[option]) << ':'
+          << (i == 13 ? 18000 : 1000);
+    }
+    log << "\nbob x medium L:100\n";
+    for (int s = 0; s < 50; ++s)
+      log << "s" << s << " 7 easy L:500 U:500 R:500\r\n";
+    log << "carol 42 medium L:1";
+  }
+
+  for (int threads : {1, 3}) {
+    Grader grader(GenerationRules(), threads);
+    grader.setChunkBytes(16);
+    std::FILE *out = std::fopen(outPath.c_str(), "w");
+    std::string error;
+    assert(grader.gradeFile(logPath, out, error));
+    std::fclose(out);
+
+    std::ifstream in(outPath);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(in, line);)
+      lines.push_back(line);
+    assert(lines.size() == 53);
+    // 10 at level 1 and 2 at level 2.
+    assert(lines[0] == "alice 12 1 2 140 2133");
+    assert(lines[1] == "bob error: bad seed 'x'");
+    for (int s = 0; s < 50; ++s) {
+      std::string prefix = "s" + std::to_string(s) + " ";
+      assert(lines[2 + s].compare(0, prefix.size(), prefix) == 0);
+    }
+    assert(lines[52].compare(0, 6, "carol ") == 0);
+
+    const GradeTotals &totals = grader.totals();
+    assert(totals.sessions == 52 && totals.malformed == 1);
+    assert(totals.answers[(int)Difficulty::EASY] == 150);
+    assert(totals.correct[(int)Difficulty::MEDIUM] >= 12);
+    assert(totals.timeouts == 2);
+  }
+
+  std::string error;
+  Grader grader(GenerationRules(), 2);
+  assert(!grader.gradeFile("/tmp/unlimitedmath_no_such.log", stdout, error));
+  std::remove(logPath.c_str());
+  std::remove(outPath.c_str());
+  std::cout << "testGrader passed." << std::endl;
+}
+
+// Plays a seeded game on a null terminal, keys through a pipe, across two
+// level screens: it must ask exactly problemAt(1 + i / 10, i), as the grader
+// assumes.
+void testSeededGameLevels() {
+  int keyPipe[2];
+  assert(pipe(keyPipe) == 0);
+  FILE *out = std::fopen("/dev/null", "w");
+  FILE *in = fdopen(keyPipe[0], "r");
+  assert(out != nullptr && in != nullptr);
+  {
+    Game game("xterm", out, in, "test");
+    assert(game.hasTerminal());
+    game.setSeed(4242);
+    MathGenerator gen;
+    gen.setSeed(4242);
+    gen.setDifficulty(Difficulty::EASY);
+
+    const char *answerKeys[] = {"\033OD", "\033OA", "\033OC"}; // L U R
+    auto press = [&](const char *key) {
+      ssize_t length = (ssize_t)std::strlen(key);
+      assert(write(keyPipe[1], key, length) == length);
+      game.pollInput();
+    };
+    game.start();
+    press("\n"); // Start Game
+    for (std::uint64_t i = 0; i < 25; ++i) {
+      if (i > 0 && i % 10 == 0)
+        press(" "); // Next level
+      MathProblem expected = gen.problemAt(1 + (int)(i / 10), i);
+      ProblemView shown = game.shownProblem();
+      assert(shown.question == expected.question);
+      press(answerKeys[expected.correctOptionIndex]);
+    }
+  }
+  close(keyPipe[1]);
+  std::fclose(in);
+  std::fclose(out);
+  std::cout << "testSeededGameLevels passed." << std::endl;
+}
+
 int main() {
   testDifficultyEasy();
   testDifficultyMedium();
   testUniqueOptions();
   testEasyScaling();
   testUniqueOperands();
+  testSeededDeterminism();
+  testSeededRandomAccess();
+  testSeededUniqueOperands();
+  testClassifier();
+  testDifficultyBand();
+  testReviewScheduler();
+  testReviewMixing();
+  testScoreboard();
+  testProblemFilter();
+  testSessionFilter();
+  testProblemBank();
+  testMetrics();
+  testVirtualTerminal();
+  testGenerationRules();
+  testChainedResultsFit();
+  testGrader();
+  testSeededGameLevels();
   std::cout << "All tests passed!" << std::endl;
   return 0;
 }
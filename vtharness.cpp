@@ -0,0 +1,572 @@
+// Runs the ncurses UI on a pseudo-terminal in every language, feeds it
+// scripted keys and replays what it writes through VirtualTerminal. Reports
+// bytes and changed cells per frame for each screen, and frames per second
+// for gameplay.
+//
+//   ./vtharness                      measure every screen and language
+//   ./vtharness --check              compare first frames with snapshots/ and
+//                                    check that kiosk seats do not stall
+//                                    each other
+//   ./vtharness --update-snapshots   rewrite snapshots/ from the current UI
+//   ./vtharness --seats N            memory and CPU per seat: N games as N
+//                                    processes against one --seat kiosk
+#include "MathGenerator.h"
+#include "UI.h"
+#include "VirtualTerminal.h"
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <poll.h>
+#include <signal.h>
+#include <sstream>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const int kWidth = 80;
+static const int kHeight = 24;
+static const int kGameFrames = 240;
+static const int kAnimationFrames = 3; // Each waits for the animation tick
+// A menu frame is complete once the terminal has been quiet this long.
+static const int kQuietMs = 20;
+static const char *const kSnapshotDir = "snapshots";
+static const char *const kGameBinary = "./unlimitedmath";
+static const int kSeatPlayMs = 5000; // Gameplay measured per seat comparison
+// Longest a kiosk seat may take to answer a key while another seat is in the
+// middle of an escape sequence.
+static const int kMaxSeatStallMs = 200;
+
+static const char *const kLanguages[] = {
+    "English", "German", "French",    "Spanish", "Italian",  "Portuguese",
+    "Dutch",   "Polish", "Ukrainian", "Chinese", "Japanese", "Korean"};
+
+static const char *const kKeyUp = "\033OA";
+static const char *const kKeyDown = "\033OB";
+static const char *const kKeyRight = "\033OC";
+static const char *const kKeyLeft = "\033OD";
+static const char *const kKeyEnter = "\n";
+
+// A raw pseudo-terminal of kWidth x kHeight. The UI gets the slave side as
+// its terminal; the harness reads the output and writes keys on the master.
+class Pty {
+public:
+  Pty() : master(-1), in(nullptr), out(nullptr) {}
+  ~Pty() {
+    if (in != nullptr)
+      std::fclose(in);
+    if (out != nullptr)
+      std::fclose(out);
+    if (master >= 0)
+      close(master);
+  }
+
+  bool open() {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+      return false;
+    int slave = ::open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0)
+      return false;
+    // Raw: no echo of the scripted keys and no newline translation, so the
+    // bytes read back are exactly what ncurses wrote.
+    termios mode;
+    tcgetattr(slave, &mode);
+    cfmakeraw(&mode);
+    tcsetattr(slave, TCSANOW, &mode);
+    winsize size{};
+    size.ws_row = kHeight;
+    size.ws_col = kWidth;
+    ioctl(master, TIOCSWINSZ, &size);
+    in = fdopen(slave, "r");
+    out = fdopen(dup(slave), "w");
+    return in != nullptr && out != nullptr;
+  }
+
+  // Waits up to firstMs for output, then reads until the terminal has been
+  // quiet for quietMs.
+  std::string read(int firstMs, int quietMs) {
+    std::string data;
+    char buffer[4096];
+    int wait = firstMs;
+    pollfd pfd{master, POLLIN, 0};
+    while (poll(&pfd, 1, wait) > 0) {
+      ssize_t n = ::read(master, buffer, sizeof(buffer));
+      if (n <= 0)
+        break;
+      data.append(buffer, n);
+      wait = quietMs;
+    }
+    return data;
+  }
+
+  void write(const char *keys) {
+    std::size_t length = std::strlen(keys);
+    if (::write(master, keys, length) != (ssize_t)length)
+      std::perror("vtharness: write");
+  }
+
+  int master;
+  FILE *in;
+  FILE *out;
+};
+
+struct ScreenStats {
+  long frames = 0;
+  std::uint64_t bytes = 0;
+  long cellsChanged = 0;
+  double seconds = 0.0; // Only measured where frames are not paced
+};
+
+// Replays frames into the virtual terminal and accumulates their cost. The
+// grid after a screen's first frame is its snapshot.
+class Capture {
+public:
+  Capture() : terminal(kWidth, kHeight) {}
+
+  void begin() { stats = ScreenStats(); }
+
+  void frame(const std::string &bytes) {
+    VirtualTerminal before = terminal;
+    terminal.feed(bytes);
+    if (stats.frames == 0)
+      snapshot = terminal.text();
+    stats.frames++;
+    stats.bytes += bytes.size();
+    stats.cellsChanged += terminal.cellsChanged(before);
+  }
+
+  VirtualTerminal terminal;
+  ScreenStats stats;
+  std::string snapshot;
+};
+
+static std::string snapshotPath(const std::string &language,
+                                const std::string &screen) {
+  std::string name = language;
+  for (char &c : name)
+    c = (char)std::tolower((unsigned char)c);
+  return std::string(kSnapshotDir) + "/" + name + "-" + screen + ".txt";
+}
+
+static std::vector<std::string> lines(const std::string &text) {
+  std::vector<std::string> out;
+  std::istringstream stream(text);
+  std::string line;
+  while (std::getline(stream, line))
+    out.push_back(line);
+  return out;
+}
+
+// Returns false on a mismatch (or a missing snapshot) and prints the first
+// differing row.
+static bool compareSnapshot(const std::string &path, const std::string &grid) {
+  std::ifstream file(path);
+  if (!file) {
+    std::printf("MISSING  %s\n", path.c_str());
+    return false;
+  }
+  std::stringstream expected;
+  expected << file.rdbuf();
+  if (expected.str() == grid)
+    return true;
+
+  std::vector<std::string> want = lines(expected.str()), got = lines(grid);
+  want.resize(kHeight);
+  got.resize(kHeight);
+  for (int row = 0; row < kHeight; ++row)
+    if (want[row] != got[row]) {
+      std::printf("CHANGED  %s row %d\n  expected: |%s|\n  actual:   |%s|\n",
+                  path.c_str(), row, want[row].c_str(), got[row].c_str());
+      break;
+    }
+  return false;
+}
+
+// Runs a blocking screen on this thread while another thread answers it with
+// `keys`, capturing the frame drawn before each key.
+static void runWithKeys(Pty &pty, Capture &capture,
+                        const std::vector<const char *> &keys,
+                        const std::function<void()> &screen) {
+  std::thread driver([&] {
+    for (const char *key : keys) {
+      capture.frame(pty.read(1000, kQuietMs));
+      pty.write(key);
+    }
+  });
+  screen();
+  driver.join();
+}
+
+// Memory and CPU time of a running process from /proc. RSS counts shared pages
+// in full for every process, PSS splits them between the processes sharing
+// them.
+struct ProcessUsage {
+  long rssKb = 0;
+  long pssKb = 0;
+  double cpuSeconds = 0.0;
+};
+
+static ProcessUsage processUsage(pid_t pid) {
+  ProcessUsage usage;
+  std::ifstream smaps("/proc/" + std::to_string(pid) + "/smaps_rollup");
+  for (std::string line; std::getline(smaps, line);) {
+    if (line.compare(0, 4, "Rss:") == 0)
+      usage.rssKb = std::atol(line.c_str() + 4);
+    else if (line.compare(0, 4, "Pss:") == 0)
+      usage.pssKb = std::atol(line.c_str() + 4);
+  }
+  std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+  std::string text((std::istreambuf_iterator<char>(stat)),
+                   std::istreambuf_iterator<char>());
+  // Fields after the parenthesised command name; utime and stime are the
+  // 12th and 13th of them.
+  std::istringstream fields(text.substr(text.rfind(')') + 2));
+  std::string field;
+  long ticks = 0;
+  for (int i = 1; i <= 13 && fields >> field; ++i)
+    if (i >= 12)
+      ticks += std::atol(field.c_str());
+  usage.cpuSeconds = (double)ticks / sysconf(_SC_CLK_TCK);
+  return usage;
+}
+
+// Starts `args` with `terminal` (a pty slave) as its controlling terminal
+// and standard streams, or with stdio on /dev/null if `terminal` is empty.
+static pid_t spawn(const std::vector<std::string> &args,
+                   const std::string &terminal) {
+  pid_t pid = fork();
+  if (pid != 0)
+    return pid;
+  setsid();
+  int fd = open(terminal.empty() ? "/dev/null" : terminal.c_str(), O_RDWR);
+  dup2(fd, 0);
+  dup2(fd, 1);
+  dup2(fd, 2);
+  setenv("TERM", "xterm", 1);
+  std::vector<char *> argv;
+  for (const std::string &arg : args)
+    argv.push_back(const_cast<char *>(arg.c_str()));
+  argv.push_back(nullptr);
+  execv(argv[0], argv.data());
+  _exit(127);
+}
+
+// Reads whatever the games write so they never block on a full pty, for
+// `ms` milliseconds.
+static void drainFor(const std::vector<int> &masters, int ms) {
+  std::vector<pollfd> fds;
+  for (int master : masters)
+    fds.push_back(pollfd{master, POLLIN, 0});
+  char buffer[65536];
+  auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+  while (std::chrono::steady_clock::now() < end) {
+    if (poll(fds.data(), fds.size(), 10) <= 0)
+      continue;
+    for (const pollfd &fd : fds)
+      if (fd.revents & POLLIN)
+        if (::read(fd.fd, buffer, sizeof(buffer)) < 0)
+          std::perror("vtharness: read");
+  }
+}
+
+// Opens a kWidth x kHeight pty; returns its master and sets `slave`.
+static int openSeatPty(std::string &slave) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+    return -1;
+  winsize size{};
+  size.ws_row = kHeight;
+  size.ws_col = kWidth;
+  ioctl(master, TIOCSWINSZ, &size);
+  slave = ptsname(master);
+  return master;
+}
+
+// Plays `seats` games for kSeatPlayMs, either as one process per seat or as
+// one kiosk process, and prints memory and CPU per seat.
+static bool measureSeats(int seats, bool kiosk) {
+  std::vector<int> masters;
+  std::vector<std::string> slaves;
+  for (int i = 0; i < seats; ++i) {
+    std::string slave;
+    int master = openSeatPty(slave);
+    if (master < 0)
+      return false;
+    masters.push_back(master);
+    slaves.push_back(slave);
+  }
+
+  std::vector<pid_t> pids;
+  if (kiosk) {
+    std::vector<std::string> args = {kGameBinary};
+    for (const std::string &slave : slaves) {
+      args.push_back("--seat");
+      args.push_back(slave);
+    }
+    pids.push_back(spawn(args, ""));
+  } else {
+    for (const std::string &slave : slaves)
+      pids.push_back(spawn({kGameBinary}, slave));
+  }
+
+  drainFor(masters, 500); // Main menus
+  for (int master : masters)
+    if (::write(master, kKeyEnter, 1) != 1)
+      std::perror("vtharness: write");
+  // Sample CPU over the gameplay only.
+  double cpuBefore = 0.0;
+  for (pid_t pid : pids)
+    cpuBefore += processUsage(pid).cpuSeconds;
+  drainFor(masters, kSeatPlayMs);
+  ProcessUsage total;
+  for (pid_t pid : pids) {
+    ProcessUsage usage = processUsage(pid);
+    total.rssKb += usage.rssKb;
+    total.pssKb += usage.pssKb;
+    total.cpuSeconds += usage.cpuSeconds;
+  }
+
+  for (pid_t pid : pids)
+    kill(pid, SIGTERM);
+  for (pid_t pid : pids) {
+    // Keep reading so a game restoring its terminal cannot block.
+    while (waitpid(pid, nullptr, WNOHANG) == 0)
+      drainFor(masters, 10);
+  }
+  for (int master : masters)
+    close(master);
+
+  std::printf("%-17s %6d %12.0f %12.0f %16.2f\n",
+              kiosk ? "kiosk" : "process per seat", seats,
+              (double)total.rssKb / seats, (double)total.pssKb / seats,
+              (total.cpuSeconds - cpuBefore) * 1000.0 / seats /
+                  (kSeatPlayMs / 1000.0));
+  return true;
+}
+
+// Two kiosk seats: a lone ESC on the first leaves ncurses waiting for the rest
+// of a sequence, and the second must still answer its keys promptly. Returns
+// the worst delay seen, or -1 if the kiosk could not be started.
+static int measureSeatStall() {
+  std::vector<int> masters;
+  std::vector<std::string> args = {kGameBinary};
+  for (int i = 0; i < 2; ++i) {
+    std::string slave;
+    int master = openSeatPty(slave);
+    if (master < 0)
+      return -1;
+    masters.push_back(master);
+    args.push_back("--seat");
+    args.push_back(slave);
+  }
+  pid_t pid = spawn(args, "");
+  drainFor(masters, 500); // Main menus
+
+  int worstMs = 0;
+  char buffer[65536];
+  for (int round = 0; round < 4; ++round) {
+    const char *key = round % 2 == 0 ? kKeyDown : kKeyUp;
+    if (::write(masters[0], "\033", 1) != 1)
+      std::perror("vtharness: write");
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    auto sent = std::chrono::steady_clock::now();
+    if (::write(masters[1], key, std::strlen(key)) != (ssize_t)std::strlen(key))
+      std::perror("vtharness: write");
+    pollfd fd{masters[1], POLLIN, 0};
+    poll(&fd, 1, 2000); // The menu redraw
+    int ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                 std::chrono::steady_clock::now() - sent)
+                 .count();
+    if (ms > worstMs)
+      worstMs = ms;
+    if (::read(masters[1], buffer, sizeof(buffer)) < 0)
+      std::perror("vtharness: read");
+    drainFor(masters, 100);
+  }
+
+  kill(pid, SIGTERM);
+  while (waitpid(pid, nullptr, WNOHANG) == 0)
+    drainFor(masters, 10);
+  for (int master : masters)
+    close(master);
+  return worstMs;
+}
+
+static int compareSeats(int seats) {
+  if (access(kGameBinary, X_OK) != 0) {
+    std::fprintf(stderr, "vtharness: build %s first\n", kGameBinary);
+    return 1;
+  }
+  setenv("LC_ALL", "C.UTF-8", 1);
+  std::printf("%-17s %6s %12s %12s %16s\n", "setup", "seats", "RSS KB/seat",
+              "PSS KB/seat", "CPU ms/seat/s");
+  if (!measureSeats(seats, false) || !measureSeats(seats, true)) {
+    std::fprintf(stderr, "vtharness: could not open pseudo-terminals\n");
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  bool check = false, update = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--check")
+      check = true;
+    else if (arg == "--update-snapshots")
+      update = true;
+    else if (arg == "--seats" && i + 1 < argc)
+      return compareSeats(std::atoi(argv[++i]));
+  }
+  bool measure = !check && !update;
+
+  // The UI picks up the locale from the environment; it must be UTF-8 for
+  // the translations to reach the terminal intact.
+  setenv("LC_ALL", "C.UTF-8", 1);
+
+  Pty pty;
+  if (!pty.open()) {
+    std::fprintf(stderr, "vtharness: could not open a pseudo-terminal\n");
+    return 1;
+  }
+  UI ui;
+  if (!ui.initHeadless(pty.out, pty.in)) {
+    std::fprintf(stderr, "vtharness: newterm failed\n");
+    return 1;
+  }
+  Capture capture;
+  capture.terminal.feed(pty.read(100, kQuietMs)); // Terminal setup
+
+  MathGenerator gen;
+  gen.setSeed(1);
+  gen.setDifficulty(Difficulty::HARD);
+
+  if (measure)
+    std::printf("%-10s %-15s %6s %12s %12s %9s\n", "language", "screen",
+                "frames", "bytes/frame", "cells/frame", "fps");
+  int failures = 0;
+  std::uint64_t unknown = 0;
+  for (const char *language : kLanguages) {
+    ui.loadLanguage(language);
+    std::vector<std::pair<std::string, ScreenStats>> screens;
+    auto finish = [&](const char *screen) {
+      screens.emplace_back(screen, capture.stats);
+      std::string path = snapshotPath(language, screen);
+      if (update) {
+        std::ofstream(path) << capture.snapshot;
+      } else if (check && !compareSnapshot(path, capture.snapshot)) {
+        failures++;
+      }
+    };
+
+    capture.begin();
+    runWithKeys(pty, capture, {kKeyDown, kKeyDown, kKeyUp, kKeyUp, kKeyEnter},
+                [&] { ui.showMainMenu(); });
+    finish("main_menu");
+
+    // Difficulty right and back again, then Back: nothing changes.
+    capture.begin();
+    Difficulty difficulty = Difficulty::EASY;
+    std::string lang = language, bank;
+    runWithKeys(pty, capture,
+                {kKeyRight, kKeyLeft, kKeyDown, kKeyDown, kKeyEnter},
+                [&] { ui.showSettings(difficulty, lang, {}, bank); });
+    finish("settings");
+
+    // Gameplay as in bench: a correct answer every 30 frames.
+    capture.begin();
+    ui.setNonBlocking(true);
+    int score = 0, level = 1, challengesPassed = 0;
+    float timeLeft = 1.0f;
+    MathProblem problem = gen.problemAt(level, 0);
+    int frames = measure ? kGameFrames : 1;
+    auto start = std::chrono::steady_clock::now();
+    for (int frame = 0; frame < frames; ++frame) {
+      timeLeft -= 0.00083f;
+      if (frame % 30 == 29) {
+        score += 10 * level;
+        problem = gen.problemAt(level, ++challengesPassed);
+        timeLeft = 1.0f;
+      }
+      ui.drawGame(score, level, challengesPassed, problem.view(), timeLeft);
+      ui.present();
+      capture.frame(pty.read(0, 0));
+    }
+    capture.stats.seconds = std::chrono::duration<double>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+    finish("game");
+
+    capture.begin();
+    ui.beginGameOver(1230, 7);
+    capture.frame(pty.read(0, 0));
+    for (int i = 0; measure && i < kAnimationFrames; ++i) {
+      ui.pollAnimatedScreen();
+      capture.frame(pty.read(0, 0));
+    }
+    ui.endAnimatedScreen();
+    finish("game_over");
+
+    capture.begin();
+    ui.beginLevelComplete(7);
+    capture.frame(pty.read(0, 0));
+    for (int i = 0; measure && i < kAnimationFrames; ++i) {
+      ui.pollAnimatedScreen();
+      capture.frame(pty.read(0, 0));
+    }
+    ui.endAnimatedScreen();
+    finish("level_complete");
+
+    if (measure)
+      for (const auto &screen : screens) {
+        const ScreenStats &s = screen.second;
+        std::printf("%-10s %-15s %6ld %12.1f %12.1f", language,
+                    screen.first.c_str(), s.frames,
+                    (double)s.bytes / s.frames,
+                    (double)s.cellsChanged / s.frames);
+        if (s.seconds > 0.0)
+          std::printf(" %9.0f\n", s.frames / s.seconds);
+        else
+          std::printf(" %9s\n", "-");
+      }
+  }
+  unknown = capture.terminal.unknownSequences();
+  ui.cleanup();
+
+  if (unknown > 0)
+    std::printf("warning: %llu escape sequences not understood\n",
+                (unsigned long long)unknown);
+  if (check && failures > 0) {
+    std::printf("%d snapshots differ; run ./vtharness --update-snapshots if "
+                "the change is intended\n",
+                failures);
+    return 1;
+  }
+  if (check)
+    std::printf("All snapshots match.\n");
+
+#ifdef __linux__ // Kiosk mode is Linux only
+  if (check) {
+    int stallMs = measureSeatStall();
+    if (stallMs < 0 || stallMs > kMaxSeatStallMs) {
+      std::printf("kiosk seat answered after %d ms while another seat sent "
+                  "ESC (limit %d ms)\n",
+                  stallMs, kMaxSeatStallMs);
+      return 1;
+    }
+    std::printf("Kiosk seats answer within %d ms of each other's ESC.\n",
+                stallMs);
+  }
+#endif
+  return 0;
+}